@@ -3,11 +3,18 @@
 
 #include <vector>
 #include <string>
+#include <unordered_set>
 #include "PerlinNoise.h"
+#include "VoronoiNoise.h"
+#include "SimplexNoise.h"
+#include "SpectralNoise.h"
 #include <imgui.h>
 #include <cmath>
 
 class Node;
+class NodeCompiler;
+
+inline float clamp(float v) { return (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v; }
 
 struct Slot
 {
@@ -32,6 +39,13 @@ class Node
         const char *Name() const;
         int ID() const;
 
+        // Bumped whenever a parameter or input link of this node changes. Code that edits the
+        // public parameters of a node directly should call Touch() afterwards.
+        unsigned Version() const;
+        void Touch();
+        // Hash of the versions and links of this node and everything upstream of it
+        uint64_t GraphHash() const;
+
         bool IsInputSlotConnected(unsigned slotNum) const;
         bool IsOutputSlotConnected(unsigned slotNum) const;
         void ConnectInputSlot(unsigned thisSlot, Node *toNode, unsigned toSlot);
@@ -45,20 +59,33 @@ class Node
         ImVec2 OutputSlotPos(unsigned slotNum) const;
 
         virtual float Evaluate(float x, float y, float z) const = 0;
+        // Evaluates count samples in one call, out[i] receives the value at (x[i], y[i], z[i])
+        virtual void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        // Value and its slopes along x and y. The default takes forward differences of Evaluate, nodes
+        // that can differentiate their output analytically override it.
+        virtual float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        // Emits the instructions computing this node and returns the register holding its value
+        virtual unsigned Compile(NodeCompiler &compiler) const = 0;
 
         virtual void DrawControls(ImDrawList *drawList) = 0;
 
         virtual void Reset() { };
         virtual Node *Clone() = 0;
 
+        // Step of the forward differences taken for nodes without analytic slopes
+        static const float GradientStep;
+
         ImVec2 pos;
         ImVec2 size;
 
     protected:
         void InputCount(unsigned count);
         void OutputCount(unsigned count);
+        const Node *InputNode(unsigned slotNum) const;
 
     private:
+        void HashGraph(uint64_t &hash, std::unordered_set<const Node *> &visited) const;
+
         unsigned inputCount;
         unsigned outputCount; 
         std::vector<Slot> inputSlots;
@@ -68,6 +95,7 @@ class Node
 
         static int idCounter;
         int id;
+        unsigned version;
 };
 
 
@@ -87,6 +115,9 @@ class Perlin : public Generator
         Perlin() : Generator("Perlin"), noise(0) { Reset(); };
 
         float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         void DrawControls(ImDrawList *drawList);
         void Reset();
@@ -98,12 +129,16 @@ class Perlin : public Generator
         float frequency;
         float persistence;
         float lacunarity;
+        // Use the table-free integer hash lattice, see PerlinNoise::HashedLattice
+        bool hashedLattice;
 
         StyleFunc style;
 
         static float Classic(float v) { return v; };
         static float Billowy(float v) { return fabs(v - 0.5f) + 0.5f; };
         static float Ridged(float v) { return 0.5f - fabs(v - 0.5f); };
+        // Derivative of one of the styles above at v
+        static float StyleSlope(StyleFunc style, float v);
 
     private:
         noise::PerlinNoise noise;
@@ -111,12 +146,104 @@ class Perlin : public Generator
         int currentStyleIdx;
 };
 
+// Same controls and styles as Perlin, on the cheaper simplex grid
+class Simplex : public Generator
+{
+    public:
+        Simplex() : Generator("Simplex"), noise(0) { Reset(); };
+
+        float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
+        void DrawControls(ImDrawList *drawList);
+        void Reset();
+
+        Node *Clone() { return new Simplex(*this); }
+
+        uint64_t seed;
+        unsigned octaves;
+        float frequency;
+        float persistence;
+        float lacunarity;
+
+        Perlin::StyleFunc style;
+
+    private:
+        noise::SimplexNoise noise;
+
+        int currentStyleIdx;
+};
+
+// Fbm shaped in the frequency domain, see noise::SpectralNoise. Tiles over the unit square and costs
+// the same whatever the octave count, but ignores z. The octaves are capped by the frequency, see
+// noise::SpectralNoise::MaxOctaves.
+class Spectral : public Generator
+{
+    public:
+        Spectral() : Generator("Spectral"), noise(0) { Reset(); };
+
+        float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
+        void DrawControls(ImDrawList *drawList);
+        void Reset();
+
+        Node *Clone() { return new Spectral(*this); }
+
+        uint64_t seed;
+        unsigned octaves;
+        float frequency;
+        float persistence;
+
+        Perlin::StyleFunc style;
+
+    private:
+        noise::SpectralNoise noise;
+
+        int currentStyleIdx;
+};
+
+class Voronoi : public Generator
+{
+    public:
+        enum Feature { F1, F2, F2MinusF1, CellID };
+
+        Voronoi() : Generator("Voronoi"), noise(0) { Reset(); };
+
+        float Evaluate(float x, float y, float z) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
+        void DrawControls(ImDrawList *drawList);
+        void Reset();
+
+        Node *Clone() { return new Voronoi(*this); }
+
+        uint64_t seed;
+        float frequency;
+        Feature feature;
+        // One point per cell in the xy plane, faster but 2D only
+        bool jittered;
+        bool hashedLattice;
+
+        static float Select(const noise::VoronoiNoise::Features &features, Feature feature);
+
+    private:
+        noise::VoronoiNoise noise;
+
+        int currentMetricIdx;
+};
+
 class Constant : public Generator
 {
     public:
         Constant() : Generator("Constant") { Reset(); };
 
         float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         void DrawControls(ImDrawList *drawList);
         void Reset();
@@ -132,6 +259,8 @@ class Gradient : public Generator
         Gradient() : Generator("Gradient") { Reset(); };
 
         float Evaluate(float x, float y, float z) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         void DrawControls(ImDrawList *drawList);
         void Reset();
@@ -158,7 +287,14 @@ class Abs : public Filter
 
         float Evaluate(float x, float y, float z) const;
 
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
         Node *Clone() { return new Abs(*this); }
+
+        static float Apply(float v) { return fabs(v + -0.5f) + 0.5f; };
+        static float ApplySlope(float v) { return v < 0.5f ? -1.0f : 1.0f; };
 };
 
 class Invert : public Filter
@@ -170,7 +306,13 @@ class Invert : public Filter
 
         float Evaluate(float x, float y, float z) const;
 
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
         Node *Clone() { return new Invert(*this); }
+
+        static float Apply(float v) { return 1.0f - v; };
 };
 
 class Selector : public Filter
@@ -182,11 +324,45 @@ class Selector : public Filter
         void DrawControls(ImDrawList *drawList);
 
         float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         Node *Clone() { return new Selector(*this); }
 
         float min, max;
         float falloff;
+
+        static float Select(float v, float min, float max, float falloff);
+        // Derivative of Select with respect to v
+        static float SelectSlope(float v, float min, float max, float falloff);
+};
+
+// Steepness or surface normal of its input read as a height field. Perlin noise and the filters and
+// combiners pass on analytic slopes, other generators are differentiated numerically.
+class Slope : public Filter
+{
+    public:
+        enum Channel { Steepness, NormalX, NormalY, NormalZ };
+
+        Slope() : Filter("Slope") { Reset(); };
+
+        void Reset();
+        void DrawControls(ImDrawList *drawList);
+
+        float Evaluate(float x, float y, float z) const;
+        // Slopes of a slope are not tracked, the result reads as flat
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
+
+        Node *Clone() { return new Slope(*this); }
+
+        // Height of the full input range, relative to the width of the image
+        float height;
+        Channel channel;
+
+        // Steepness is the slope angle scaled to [0, 1], normal components are mapped from [-1, 1]
+        static float Shade(float dx, float dy, float height, Channel channel);
 };
 
 // Base class for combiners, nodes that combine two inputs together 
@@ -205,6 +381,9 @@ class Combine : public Combiner
         Combine() : Combiner("Combine") { Reset(); };
 
         float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         void Reset();
         void DrawControls(ImDrawList *drawList);
@@ -216,6 +395,9 @@ class Combine : public Combiner
 
         static float Add(float a, float b) { return a + b; };
         static float Multiply(float a, float b) { return a * b; };
+        // Derivatives of the functions above given the slopes of a and b
+        static float AddSlope(float a, float b, float da, float db) { return da + db; };
+        static float MultiplySlope(float a, float b, float da, float db) { return da * b + a * db; };
 
     private:
         int currentFuncIdx;
@@ -234,6 +416,9 @@ class ImageOutput : public Output
         ImageOutput() : Output("Image Output") { Reset(); };
 
         float Evaluate(float x, float y, float z) const;
+        void EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const;
+        float EvaluateGradient(float x, float y, float z, float &dx, float &dy) const;
+        unsigned Compile(NodeCompiler &compiler) const;
 
         void Reset();
         void DrawControls(ImDrawList *drawList);
@@ -243,6 +428,12 @@ class ImageOutput : public Output
     private:
         char buffer[128];
         unsigned imageSize;
+        // Saves through a native build of the graph, see NodeProgram::CompileNative
+        bool native;
+        // Set when the last save fell back from native code to the interpreter
+        bool nativeFailed;
+        // Saves a lone classic Perlin generator from the fixed-point kernels, see NodeRenderer::FixedPoint
+        bool fixedPoint;
 };
 
 
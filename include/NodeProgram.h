@@ -0,0 +1,187 @@
+#ifndef __NODE_PROGRAM_H__
+#define __NODE_PROGRAM_H__
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "PerlinNoise.h"
+#include "VoronoiNoise.h"
+#include "SimplexNoise.h"
+#include "SpectralNoise.h"
+
+class Node;
+
+enum class Opcode
+{
+    Perlin,     // dst = style(fbm(x, y, z)), params: frequency, persistence, lacunarity
+    Simplex,    // as Perlin, on simplex noise
+    Spectral,   // dst = style(spectral(x, y)), the spectrum is baked into the noise resource
+    Voronoi,    // dst = Voronoi::Select(features(x, y, z), variant), params: frequency
+    JitteredVoronoi,    // as Voronoi, with one point per cell in the xy plane
+    Constant,   // dst = params[0]
+    Abs,        // dst = Abs::Apply(src0)
+    Invert,     // dst = Invert::Apply(src0)
+    Selector,   // dst = Selector::Select(src0), params: min, max, falloff
+    Add,        // dst = clamp(src0 + src1 * params[0])
+    Multiply,   // dst = clamp(src0 * (src1 * params[0]))
+    Slope       // dst = Slope::Shade(gradient of src0), params: height, variant: channel
+};
+
+struct Instruction
+{
+    typedef float (*StyleFunc)(float);
+
+    Instruction(Opcode op, unsigned src0 = 0, unsigned src1 = 0) : op(op), dst(0), src{ src0, src1 }, params{ 0, 0, 0, 0 }, octaves(0), variant(0), resource(0), style(nullptr), gradient(false) { };
+
+    Opcode op;
+    unsigned dst;
+    unsigned src[2];
+
+    float params[4];
+    unsigned octaves;
+    unsigned variant;   // Option picking between flavours of an opcode
+    unsigned resource;  // Index of the noise generator of the opcode's type owned by the program
+    StyleFunc style;
+    bool gradient;      // Also computes the slopes of dst along x and y, set by the compiler
+};
+
+// A flat, self-contained list of register instructions computing a node graph. It keeps copies of
+// every parameter and noise table it needs, so it stays valid while the graph is edited.
+class NodeProgram
+{
+    public:
+        static const unsigned BlockSize = 256;
+
+        NodeProgram() : registerCount(0), output(0), gradients(false) { };
+
+        // A nonzero spacing is the distance between neighbouring samples; fractal generators then skip
+        // the octaves too fine to show at it
+        void Run(const float *x, const float *y, const float *z, float *out, unsigned count, float spacing = 0) const;
+        // Samples a plane of constant z. On the z = 0 plane generators switch to their cheaper 2D paths.
+        void Run(const float *x, const float *y, float z, float *out, unsigned count, float spacing = 0) const;
+        // Samples the grid of points (x[i], y[j], z) for i < width and j < height into out, row by row.
+        // Same result as Run on the expanded grid, but Perlin generators share corner gradients
+        // between the columns of a lattice cell, see PerlinNoise::SampleGrid.
+        void RunGrid(const float *x, unsigned width, const float *y, unsigned height, float z, float *out, float spacing = 0) const;
+        // Renders the regular grid x0 + i * dx, y0 + j * dy of the z = 0 plane straight to 8-bit grey
+        // on the fixed-point kernels, see PerlinNoise::SampleGridFixed. Only programs made of a lone
+        // Perlin generator of the classic style qualify; for any other it returns false and leaves
+        // out untouched.
+        bool RunGridFixed(float x0, float dx, unsigned width, float y0, float dy, unsigned height, uint8_t *out, float spacing = 0) const;
+
+        // Bounds of the output over the rectangle [x0, x1] x [y0, y1] at depth z, propagated through
+        // the instructions with interval arithmetic: everything Run or RunGrid computes in it lies
+        // within [*min, *max]. Equal bounds mean every point evaluates to exactly that value. Any
+        // rectangle is accepted; those reaching below zero get loose bounds, see PerlinNoise::Range.
+        void Range(float x0, float y0, float x1, float y1, float z, float *min, float *max, float spacing = 0) const;
+
+        // Translates the program into C++ with the parameters of its instructions written in as
+        // literals, builds that into a shared library with the system compiler ($CXX, or c++) and runs
+        // it in place of the interpreter. Runs of arithmetic instructions become one loop each, noise
+        // is still sampled by the generators of the program. Libraries are cached on disk under a hash
+        // of their source, so compiling the same graph again only loads them. Returns false and keeps
+        // interpreting for programs computing slopes, or when the library cannot be built.
+        bool CompileNative();
+        bool Native() const { return native != nullptr; };
+
+        const std::vector<Instruction> &Instructions() const { return instructions; };
+        unsigned RegisterCount() const { return registerCount; };
+
+    private:
+        friend class NodeCompiler;
+        friend class NativeWriter;
+
+        // Whole rows of a RunGrid call making up one block
+        struct GridRows
+        {
+            const float *x;
+            unsigned width;
+            const float *y;
+            unsigned height;
+            float z;
+        };
+
+        // A null z samples the z = 0 plane. Each register r has its slopes along x and y at
+        // gradients + 2 * r * BlockSize, gradients is null when no instruction needs them. A block of
+        // grid rows also passes them as grid.
+        void RunBlock(const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid = nullptr) const;
+        // Runs the instructions from begin to end, entering the masked ranges from the given one on
+        void RunRange(unsigned begin, unsigned end, unsigned range, const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid) const;
+        // Runs a masked range on the lanes its mask leaves nonzero and returns the next range outside it
+        unsigned RunMasked(unsigned range, const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid) const;
+        // Instructions depending only on the coordinates
+        void Generate(const Instruction &instruction, const float *x, const float *y, const float *z, float *dst, unsigned count, float spacing, const GridRows *grid = nullptr) const;
+        // RunBlock on the native kernel
+        void RunNative(const float *x, const float *y, const float *z, float *registers, unsigned count, float spacing, const GridRows *grid) const;
+        // Generated C++ of the native kernel, empty when a parameter has no literal
+        std::string NativeSource() const;
+        // Called back by native kernels: one Perlin generator without its style, and any generator
+        static void NativePerlin(const void *program, unsigned resource, const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, const void *grid);
+        static void NativeGenerate(const void *program, unsigned instruction, const float *x, const float *y, const float *z, float *out, unsigned count, float spacing, const void *grid);
+        // Bounds of one instruction over the rectangle from the bounds lo and hi of its sources, see Range
+        void InstructionRange(const Instruction &instruction, const float *lo, const float *hi, float x0, float y0, float x1, float y1, float z, float spacing, float *min, float *max) const;
+        // Slopes of a generator by forward differences, for those without analytic ones
+        void Differentiate(const Instruction &instruction, const float *x, const float *y, const float *z, const float *value, float *dx, float *dy, unsigned count, float spacing) const;
+
+        // Instructions begin to end compute the unmasked source of the Multiply at end, and nothing
+        // else. They only run on the lanes where its mask source, a Selector, is nonzero, packed
+        // together, and leave zero on the others. The registers they read from before begin are
+        // read through copies that can be packed the same way. Sorted by begin, outer ranges first.
+        struct MaskedRange
+        {
+            unsigned begin;
+            unsigned end;
+            unsigned mask;      // Source of the Multiply holding the mask
+            std::vector<unsigned> inputs;
+            std::vector<unsigned> copies;
+        };
+
+        std::vector<Instruction> instructions;
+        std::vector<MaskedRange> masked;
+        std::vector<noise::PerlinNoise> perlin;
+        std::vector<noise::VoronoiNoise> voronoi;
+        std::vector<noise::SimplexNoise> simplex;
+        std::vector<noise::SpectralNoise> spectral;
+        // Shared by copies, unloaded with the last of them
+        struct NativeKernel;
+        std::shared_ptr<const NativeKernel> native;
+        unsigned registerCount;
+        unsigned output;
+        bool gradients;
+};
+
+// Topologically sorts the graph reachable from a node and lets each node emit its instructions
+class NodeCompiler
+{
+    public:
+        static NodeProgram Compile(const Node *node);
+
+        unsigned Input(const Node *node, unsigned slotNum);
+        unsigned Emit(Instruction instruction);
+        unsigned AddNoise(const noise::PerlinNoise &noise);
+        unsigned AddNoise(const noise::VoronoiNoise &noise);
+        unsigned AddNoise(const noise::SimplexNoise &noise);
+        unsigned AddNoise(const noise::SpectralNoise &noise);
+
+    private:
+        NodeCompiler() : zeroRegister(-1) { };
+
+        void Sort(const Node *node, std::vector<const Node *> &order);
+        void Optimize();
+        void MarkGradients();
+        void MaskBranches();
+        void AllocateRegisters();
+        void CopyMaskedInputs();
+        unsigned ZeroRegister();
+        // Value of an instruction whose sources all hold constants
+        static float Fold(Instruction instruction, const float *values);
+
+        NodeProgram program;
+        std::unordered_set<const Node *> visited;
+        std::unordered_map<const Node *, unsigned> registers;
+        int zeroRegister;
+};
+
+#endif
\ No newline at end of file
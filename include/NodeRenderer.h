@@ -2,24 +2,50 @@
 #define __NODE_RENDERER_H__
 
 #include <vector>
+#include <atomic>
 #include "Node.h"
+#include "ThreadPool.h"
+
+class NodeProgram;
 
 class NodeRenderer
 {
     public:
         typedef std::vector<unsigned char> ImageData;
 
+        static const unsigned TileSize = 64;
+
         NodeRenderer() : NodeRenderer(128) { };
-        NodeRenderer(unsigned size) : imageSize(size), image(size * size * 3) { };
+        NodeRenderer(unsigned size, ThreadPool &pool = ThreadPool::Shared()) : imageSize(size), image(size * size * 3), pool(pool), cancel(nullptr), limitOctaves(false), fixedPoint(false) { };
 
         const ImageData &Render(const Node *node);
+        const ImageData &Render(const NodeProgram &program);
 
         unsigned ImageSize() const { return imageSize; };
         void ImageSize(unsigned size) { imageSize = size; };
 
+        // Tiles not yet started are skipped once the flag is set, leaving the image incomplete
+        void CancelFlag(const std::atomic<bool> *flag) { cancel = flag; };
+
+        // Skips noise octaves finer than the pixel grid can show. Much faster for small images, but
+        // no longer identical to evaluating the graph, so it is meant for previews. Off by default.
+        bool LimitOctaves() const { return limitOctaves; };
+        void LimitOctaves(bool limit) { limitOctaves = limit; };
+
+        // Renders programs that are a lone classic Perlin generator on the fixed-point kernels, see
+        // NodeProgram::RunGridFixed. Pixels may come out one level off the float path. Off by default.
+        bool FixedPoint() const { return fixedPoint; };
+        void FixedPoint(bool fixed) { fixedPoint = fixed; };
+
     private:
+        void RenderTile(const NodeProgram &program, unsigned tileX, unsigned tileY);
+
         unsigned imageSize;
         ImageData image;
+        ThreadPool &pool;
+        const std::atomic<bool> *cancel;
+        bool limitOctaves;
+        bool fixedPoint;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef __NOISE_KERNELS_H__
+#define __NOISE_KERNELS_H__
+
+// Vectorized sampling kernels behind the block Sample functions of the noise classes. Each kernel
+// handles any count, including a tail shorter than its vector width, and treats a null z as the
+// z = 0 plane, sampling only the four corners of the front face. They are only built for x86,
+// other targets use the scalar loops.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NOISE_X86_KERNELS
+#endif
+
+#include <cstdint>
+
+namespace noise {
+
+    namespace kernels {
+
+        // Either a permutation table or, when that is null, the seed of the integer lattice hash
+        struct Lattice
+        {
+            const unsigned *permutation;
+            unsigned seed;
+        };
+
+        // Seeded integer hash of a lattice point. Kernels compute the same function in vector lanes.
+        const unsigned latticeX = 0x8da6b343u, latticeY = 0xd8163841u, latticeZ = 0xcb1ab31fu;
+        const unsigned latticeMix1 = 0x7feb352du, latticeMix2 = 0x846ca68bu;
+
+        inline unsigned LatticeHash(unsigned x, unsigned y, unsigned z, unsigned seed)
+        {
+            unsigned h = seed ^ x * latticeX ^ y * latticeY ^ z * latticeZ;
+            h ^= h >> 16;
+            h *= latticeMix1;
+            h ^= h >> 15;
+            h *= latticeMix2;
+            h ^= h >> 16;
+            return h;
+        }
+
+        struct FractalParams
+        {
+            unsigned octaves;
+            float frequency;
+            float persistence;
+            float lacunarity;
+            float spacing;
+            // Octaves already summed into out, the kernel picks up the sum from there. Perlin only.
+            unsigned first;
+        };
+
+        // Weight of an octave sampled at the given spacing. Octaves finer than four samples per cycle
+        // fade out until they reach the Nyquist limit of two and are skipped from there on. A spacing
+        // of 0 keeps every octave at full weight.
+        inline float OctaveWeight(float frequency, float spacing)
+        {
+            float cycles = frequency * spacing;
+            if (cycles <= 0.25f) {
+                return 1.0f;
+            }
+            return cycles >= 0.5f ? 0.0f : (0.5f - cycles) * 4.0f;
+        }
+
+        void PerlinSSE2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+        void PerlinAVX2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+        void PerlinAVX512(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+
+        // A run of grid samples inside one lattice cell. The corner gradients are fixed along it, so
+        // each sample only needs its fade weight and lerps. Corners are ordered x, then y, then z,
+        // planar spans use the first four.
+        struct GridSpan
+        {
+            float gx[8];    // x components of the corner gradients
+            float ty[8];    // y terms of the corner dot products, gy * (yRel - cy)
+            float tz[8];    // z terms, gz * (zRel - cz)
+            float v, w;     // eased yRel and zRel
+            bool planar;
+        };
+
+        // Adds scale times one octave of Perlin noise at each x of a span to out, x already scaled by
+        // the octave frequency
+        void PerlinSpanSSE2(const GridSpan &span, const float *x, float *out, unsigned count, float scale);
+        void PerlinSpanAVX2(const GridSpan &span, const float *x, float *out, unsigned count, float scale);
+        void PerlinSpanAVX512(const GridSpan &span, const float *x, float *out, unsigned count, float scale);
+
+        // Fixed-point GridSpan of a planar row: the y terms of the corner dot products in Q13, the
+        // eased yRel in Q15
+        struct FixedSpan
+        {
+            int16_t gx[4];
+            int16_t ty[4];
+            int16_t v;
+        };
+
+        // Adds scale, in Q15, times one octave of planar Perlin noise to the Q13 sums in out, for each
+        // x fraction of a span given in Q16. The fade, dot products and lerps all run on 16-bit lanes,
+        // 8 per SSE2 vector and 16 per AVX2 one; AVX-512 CPUs take the AVX2 kernel. Results match the
+        // scalar path exactly.
+        void PerlinSpanFixedSSE2(const FixedSpan &span, const uint16_t *x, int16_t *out, unsigned count, int16_t scale);
+        void PerlinSpanFixedAVX2(const FixedSpan &span, const uint16_t *x, int16_t *out, unsigned count, int16_t scale);
+
+        // Fractal Perlin noise and its derivatives along x and y, see PerlinNoise::SampleGradient. There is
+        // no SSE2 version, CPUs without AVX2 take the scalar loop.
+        void PerlinGradientAVX2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count);
+        void PerlinGradientAVX512(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count);
+
+        // Fractal simplex noise, sampling the z = 0 plane through the 3D path
+        void SimplexSSE2(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+        void SimplexAVX2(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+        void SimplexAVX512(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count);
+
+    }
+
+}
+
+#endif
\ No newline at end of file
@@ -12,15 +12,83 @@ namespace noise {
 
             float Sample(float x, float y, float z) const;
             float Sample(float x, float y, float z, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2) const;
+            // Samples count points at once, equivalent to calling the octave Sample above for each of them.
+            // Runs on the widest SIMD kernel the CPU supports, see Simd.h; results match the scalar path
+            // bit for bit except that a zero may come out with the opposite sign.
+            // A nonzero spacing, the distance between neighbouring samples, fades out and skips the
+            // octaves too fine to show at that resolution, see kernels::OctaveWeight. The result is still
+            // normalized by the amplitudes of all octaves.
+            void Sample(const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+
+            // The z = 0 plane of the 3D noise, which only needs the four corners of the front face.
+            // Matches Sample(x, y, 0) apart from the sign of a zero.
+            float Sample2D(float x, float y) const;
+            float Sample2D(float x, float y, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2) const;
+            void Sample2D(const float *x, const float *y, float *out, unsigned count, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+
+            // Samples the grid of points (x[i], y[j], z) for i < width and j < height into out, row by
+            // row. Matches the block Sample on the expanded grid apart from the sign of a zero, and z = 0
+            // takes the planar path. Columns sharing a lattice cell share its corner gradients, so the
+            // octaves with several samples per cell only pay for the fade and lerps of each sample.
+            void SampleGrid(const float *x, unsigned width, const float *y, unsigned height, float z, float *out, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+            // Regular grid starting at (x0, y0) with steps dx and dy
+            void SampleGrid(float x0, float y0, float z, float dx, float dy, unsigned width, unsigned height, float *out, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+
+            // Fixed-point SampleGrid of the z = 0 plane for 8 and 16-bit images, writing (v + 1) / 2
+            // scaled to the range of the type. The fade, dot products and lerps run on 16-bit integers,
+            // twice the lanes per vector of the float kernels. Within one level of the float path for 8
+            // bits and about 20 levels for 16 bits; coordinates are resolved to 1 / 65536 of a cell. The
+            // octaves with fewer than a few samples per cell are summed on the float kernels.
+            void SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, uint8_t *out, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+            void SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, uint16_t *out, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+
+            // Value and analytic gradient in one pass. The value matches Sample apart from the sign of a
+            // zero, gradient receives its partial derivatives along x, y and z.
+            float SampleGradient(float x, float y, float z, float *gradient) const;
+            float SampleGradient(float x, float y, float z, float *gradient, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2) const;
+            // Block version for image planes, only the derivatives along x and y are written. A null z
+            // samples the z = 0 plane, spacing works as for the block Sample. Runs on the AVX2 and AVX-512
+            // kernels where available, with the same bit for bit guarantee as the block Sample.
+            void SampleGradient(const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
+
+            // Bounds of the octave samples over the rectangle [x0, x1] x [y0, y1] at depth z, such that
+            // every sample the block and grid samplers take in it lies within [*min, *max]. Found by
+            // interval arithmetic on the corner dot products of each lattice cell the rectangle covers,
+            // which is tight for the coarse octaves; those too fine to follow cell by cell count with
+            // the largest value noise can take, as do all octaves of rectangles reaching below x or
+            // y = 0, where the samplers are not defined.
+            void Range(float x0, float y0, float x1, float y1, float z, float *min, float *max, unsigned octaves, float frequency = 1, float persistence = 0.5, float lacunarity = 2, float spacing = 0) const;
 
             void Seed(uint64_t seed);
+            // Both sample the same values, whichever seeds they were built from
+            bool operator==(const PerlinNoise &other) const;
+
+            // Hashes lattice points with a seeded integer mixer instead of the permutation table. That
+            // takes no table lookups and repeats every 2^32 cells rather than every 256, but gives a
+            // different pattern for the same seed. Off by default.
+            bool HashedLattice() const;
+            void HashedLattice(bool hashed);
 
         private:
             unsigned permutation[256];
+            unsigned latticeSeed;
+            bool hashed;
 
             unsigned Hash(unsigned x, unsigned y, unsigned z) const;
             float Grad(unsigned x, unsigned y, unsigned z, float dx, float dy, float dz) const;
 
+            // Shared by the block samplers, a null z samples the z = 0 plane. The first octaves are
+            // taken as already summed into out.
+            void SampleBlock(const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, unsigned first = 0) const;
+            // Adds scale times one octave on a grid row to out, one span of columns per lattice cell
+            void SampleRow(const float *x, unsigned width, float y, float z, float *out, float scale) const;
+            // Bounds of one octave over a rectangle in lattice coordinates
+            void OctaveRange(float x0, float y0, float x1, float y1, float z, float *min, float *max) const;
+            // Fixed-point counterparts, summing in Q13 so that the result lies in [-8192, 8192]. Rows
+            // take x as lattice cells and Q16 fractions, y in Q16, and scale in Q15.
+            void SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, int16_t *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const;
+            void SampleRowFixed(const unsigned *cell, const uint16_t *fraction, unsigned width, uint64_t y, int16_t *out, int16_t scale) const;
+
     };
 
 }
@@ -0,0 +1,46 @@
+#ifndef __PREVIEW_RENDERER_H__
+#define __PREVIEW_RENDERER_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include "NodeRenderer.h"
+#include "NodeProgram.h"
+
+// Renders previews on a background thread, coarse to fine: 1/8, 1/4, 1/2 and then full size.
+// Requests snapshot the graph, so the editor can keep changing it, and a newer request cancels
+// the one in progress.
+class PreviewRenderer
+{
+    public:
+        PreviewRenderer(unsigned size = 128);
+        ~PreviewRenderer();
+
+        void Request(const Node *node);
+
+        // Hands out the most detailed image finished since the last call, if there is one
+        bool Poll(NodeRenderer::ImageData &image, unsigned &size);
+
+        unsigned ImageSize() const { return imageSize; };
+
+    private:
+        void WorkerLoop();
+
+        unsigned imageSize;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::unique_ptr<NodeProgram> pending;
+        std::atomic<bool> cancel;
+        bool stopping;
+
+        NodeRenderer::ImageData ready;
+        unsigned readySize;
+        bool hasReady;
+
+        std::thread worker;
+};
+
+#endif
\ No newline at end of file
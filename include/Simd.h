@@ -0,0 +1,27 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+namespace noise {
+
+    // Instruction sets the block samplers have kernels for, in increasing order of width
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    // Widest level supported by the CPU and OS, detected once at startup
+    SimdLevel DetectedSimdLevel();
+
+    // Level the block samplers dispatch to. Defaults to the detected level, and can be lowered
+    // to compare kernels; requests above the detected level are clamped to it.
+    SimdLevel ActiveSimdLevel();
+    void ActiveSimdLevel(SimdLevel level);
+
+    const char *SimdLevelName(SimdLevel level);
+
+}
+
+#endif
\ No newline at end of file
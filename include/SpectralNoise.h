@@ -0,0 +1,68 @@
+#ifndef __SPECTRAL_NOISE_H__
+#define __SPECTRAL_NOISE_H__
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace noise {
+
+    // Fractional Brownian noise synthesized in the frequency domain: white noise is shaped by the
+    // spectrum of an fbm and turned into a height field by one inverse FFT. The field repeats over the
+    // unit square, so it tiles seamlessly, and a sample costs the same whatever the octave count. It
+    // is 2D only.
+    class SpectralNoise
+    {
+        public:
+            // Fields finer than this are cut off at the octaves it can still resolve
+            static const unsigned MaxResolution = 2048;
+            // Octaves from frequency on that fit whole in a field of MaxResolution, at four samples per
+            // cycle of the finest. Bands past them are dropped, whatever the resolution sampled at.
+            static unsigned MaxOctaves(float frequency);
+
+            SpectralNoise(uint64_t seed);
+
+            // Rebuilds the field with the bands of an fbm of this many octaves starting at frequency,
+            // in cycles across the unit square. As with PerlinNoise, the amplitude falls by persistence
+            // each time the frequency doubles. Adding octaves keeps the coarser bands as they were.
+            // Like Seed it only keeps the parameters: the field is synthesized on the first sample,
+            // which takes a few hundred milliseconds at the largest resolution.
+            void Spectrum(unsigned octaves, float frequency = 1, float persistence = 0.5);
+
+            // Values are scaled to [-1, 1]
+            float Sample(float x, float y) const;
+            void Sample(const float *x, const float *y, float *out, unsigned count) const;
+
+            void Seed(uint64_t seed);
+            // Both hold the same field
+            bool operator==(const SpectralNoise &other) const;
+            // Samples along each side of the field
+            unsigned Resolution() const;
+
+        private:
+            unsigned seed;
+            unsigned octaves;
+            float frequency;
+            float persistence;
+
+            unsigned resolution;
+            // Shared between copies until the parameters change, a program keeps the field it was
+            // compiled with
+            struct Field
+            {
+                std::once_flag synthesized;
+                std::vector<float> values;
+            };
+            std::shared_ptr<Field> field;
+
+            // Picks the resolution for the current parameters and drops the field
+            void Reshape();
+            const float *Synthesized() const;
+            float Sample(const float *values, float x, float y) const;
+
+    };
+
+}
+
+#endif
\ No newline at end of file
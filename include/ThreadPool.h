@@ -0,0 +1,55 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// Persistent pool of worker threads running parallel loops. Every worker owns a range of task
+// indices and takes work from its front; a worker that runs dry steals the back half of another
+// worker's range, so uneven task costs balance out.
+class ThreadPool
+{
+    public:
+        typedef std::function<void(unsigned)> Task;
+
+        ThreadPool(unsigned threadCount);
+        ~ThreadPool();
+
+        // Runs task(i) for every i in [0, count) and returns once all of them have finished.
+        // The calling thread takes part in the work. Must not be called from inside a task.
+        void Run(unsigned count, const Task &task);
+
+        unsigned ThreadCount() const;
+
+        static ThreadPool &Shared();
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            unsigned begin = 0, end = 0;
+        };
+
+        void WorkerLoop(unsigned index);
+        void Work(unsigned index);
+        bool Pop(unsigned index, unsigned &taskIndex);
+        bool Steal(unsigned index, unsigned &taskIndex);
+
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<Queue>> queues;
+
+        std::mutex runMutex;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        const Task *task;
+        unsigned generation;
+        unsigned busy;
+        bool stopping;
+};
+
+#endif
\ No newline at end of file
@@ -13,7 +13,35 @@ namespace noise {
             float Sample(float x, float y, float z) const;
             float Sample(float x, float y, float z, float frequency) const;
 
+            // Distances to the nearest and second nearest feature point, plus an id in [0, 1) of the
+            // nearest one, all from a single search
+            struct Features
+            {
+                float f1, f2;
+                float cell;
+            };
+
+            Features SampleFeatures(float x, float y, float z) const;
+            Features SampleFeatures(float x, float y, float z, float frequency) const;
+            // Samples count points at once, resolving the metric once for all of them. A null z samples
+            // the z = 0 plane. Both run on SSE2 where available, with the same results as the scalar
+            // search.
+            void SampleFeatures(const float *x, const float *y, const float *z, Features *out, unsigned count, float frequency = 1) const;
+
+            // Cheaper 2D cellular noise with exactly one jittered feature point per cell, so the
+            // search covers a fixed 3x3 block of cells without branching on point counts
+            Features SampleJittered2D(float x, float y) const;
+            Features SampleJittered2D(float x, float y, float frequency) const;
+            void SampleJittered2D(const float *x, const float *y, Features *out, unsigned count, float frequency = 1) const;
+
             void Seed(uint64_t seed);
+            // Both sample the same values, whichever seeds they were built from
+            bool operator==(const VoronoiNoise &other) const;
+
+            // Picks each cell's point set with a seeded integer hash instead of the permutation table,
+            // so the pattern repeats every 2^32 cells rather than every 256. Off by default.
+            bool HashedLattice() const;
+            void HashedLattice(bool hashed);
 
             typedef float (*DistanceFunc)(float, float, float);
 
@@ -24,9 +52,36 @@ namespace noise {
             DistanceFunc distance = &Euclidean;
 
         private:
+            static const unsigned MaxCellPoints = 9;
+            // Rounded up to whole 4-lane vectors, the padding repeats the first point
+            static const unsigned PaddedCellPoints = 12;
+
+            // Feature points of a cell, relative to its corner. They depend only on the cell's hash,
+            // so one table covers every seed.
+            struct CellPoints
+            {
+                unsigned count;
+                float x[PaddedCellPoints], y[PaddedCellPoints], z[PaddedCellPoints];
+            };
+
+            static const CellPoints *PointTable();
+
             unsigned permutation[256];
+            unsigned latticeSeed;
+            bool hashed;
+            const CellPoints *points;
 
             unsigned Hash(unsigned x, unsigned y, unsigned z) const;
+            // Lattice cell containing a coordinate, wrapped to the table's period
+            unsigned Cell(float v) const;
+
+            // Nearest feature point search with the metric known at compile time
+            template <typename Metric> float SampleScalar(float x, float y, float z, Metric metric) const;
+            template <typename Metric> float SampleSSE2(float x, float y, float z) const;
+            template <typename Metric> Features SearchFeatures(float x, float y, float z, Metric metric) const;
+            template <typename Metric> Features SearchFeaturesSSE2(float x, float y, float z) const;
+            template <typename Metric> Features SearchJittered2D(float x, float y, Metric metric) const;
+            template <typename Search> void SearchBlock(const float *x, const float *y, const float *z, Features *out, unsigned count, float frequency, Search search) const;
 
     };
 
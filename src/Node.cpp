@@ -1,16 +1,17 @@
 #include "Node.h"
 #include <cstring>
+#include <algorithm>
 #include "NodeRenderer.h"
+#include "NodeProgram.h"
 #include "lodepng.h"
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imgui_internal.h"
 
 int Node::idCounter = 0;
+const float Node::GradientStep = 1.0f / 8192;
 
-float clamp(float v) { return (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v; }
-
-Node::Node(unsigned inputCount, unsigned outputCount, std::string name) : inputCount(inputCount), outputCount(outputCount), inputSlots(inputCount), outputSlots(outputCount), name(name), id(idCounter++) 
+Node::Node(unsigned inputCount, unsigned outputCount, std::string name) : inputCount(inputCount), outputCount(outputCount), inputSlots(inputCount), outputSlots(outputCount), name(name), id(idCounter++), version(0) 
 {
 };
 
@@ -25,6 +26,7 @@ Node::Node(const Node &other)
     outputSlots = std::vector<Slot>(outputCount);
 
     id = idCounter++;
+    version = 0;
 }
 
 unsigned Node::InputCount() const 
@@ -47,6 +49,45 @@ int Node::ID() const
     return id; 
 };
 
+unsigned Node::Version() const
+{
+    return version;
+}
+
+void Node::Touch()
+{
+    version++;
+}
+
+uint64_t Node::GraphHash() const
+{
+    std::unordered_set<const Node *> visited;
+    uint64_t hash = 14695981039346656037ull;
+    HashGraph(hash, visited);
+    return hash;
+}
+
+void Node::HashGraph(uint64_t &hash, std::unordered_set<const Node *> &visited) const
+{
+    const uint64_t prime = 1099511628211ull;
+
+    hash = (hash ^ (uint64_t)id) * prime;
+    if (!visited.insert(this).second) {
+        return;
+    }
+    hash = (hash ^ version) * prime;
+
+    for (unsigned i = 0; i < inputCount; i++) {
+        const Node *in = inputSlots[i].toNode;
+        hash = (hash ^ i) * prime;
+        if (in) {
+            in->HashGraph(hash, visited);
+        } else {
+            hash = (hash ^ 0xffffffffull) * prime;
+        }
+    }
+}
+
 bool Node::IsInputSlotConnected(unsigned slotNum) const
 {
     return InputSlot(slotNum).toNode != nullptr;
@@ -61,6 +102,7 @@ void Node::ConnectInputSlot(unsigned thisSlot, Node *toNode, unsigned toSlot)
 {
     inputSlots.at(thisSlot) = Slot(toNode, toSlot);
     toNode->outputSlots.at(toSlot) = Slot(this, thisSlot);
+    Touch();
 
     if (toSlot == toNode->OutputCount() - 1) {
         toNode->OutputCount(toNode->OutputCount() + 1);
@@ -77,6 +119,7 @@ void Node::DisconnectInputSlot(unsigned slotNum)
     output->outputCount--;
 
     slot = Slot();
+    Touch();
 }
 
 void Node::ConnectOutputSlot(unsigned thisSlot, Node *toNode, unsigned toSlot) 
@@ -113,6 +156,26 @@ Slot Node::OutputSlot(unsigned slotNum) const
     return outputSlots.at(slotNum); 
 };
 
+const Node *Node::InputNode(unsigned slotNum) const
+{
+    return inputSlots[slotNum].toNode;
+}
+
+void Node::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = Evaluate(x[i], y[i], z[i]);
+    }
+}
+
+float Node::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    float v = Evaluate(x, y, z);
+    dx = (Evaluate(x + GradientStep, y, z) - v) / GradientStep;
+    dy = (Evaluate(x, y + GradientStep, z) - v) / GradientStep;
+    return v;
+}
+
 void Node::InputCount(unsigned count)
 {
     for (unsigned i = count; i < inputCount; i++) {
@@ -151,19 +214,67 @@ float Perlin::Evaluate(float x, float y, float z) const
     return style((p + 1.0f) / 2.0f);
 }
 
+void Perlin::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    noise.Sample(x, y, z, out, count, octaves, frequency, persistence, lacunarity);
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = style((out[i] + 1.0f) / 2.0f);
+    }
+}
+
+float Perlin::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    float gradient[3];
+    float p = noise.SampleGradient(x, y, z, gradient, octaves, frequency, persistence, lacunarity);
+    float v = (p + 1.0f) / 2.0f;
+    float slope = StyleSlope(style, v) / 2.0f;
+    dx = gradient[0] * slope;
+    dy = gradient[1] * slope;
+    return style(v);
+}
+
+float Perlin::StyleSlope(StyleFunc style, float v)
+{
+    if (style == Billowy) {
+        return v < 0.5f ? -1.0f : 1.0f;
+    } else if (style == Ridged) {
+        return v < 0.5f ? 1.0f : -1.0f;
+    }
+    return 1.0f;
+}
+
+unsigned Perlin::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(Opcode::Perlin);
+    instruction.params[0] = frequency;
+    instruction.params[1] = persistence;
+    instruction.params[2] = lacunarity;
+    instruction.octaves = octaves;
+    instruction.style = style;
+    instruction.resource = compiler.AddNoise(noise);
+    return compiler.Emit(instruction);
+}
+
 const char *perlinComboItems[] = {
     "Classic", "Billowy", "Ridged"
 };
 
 void Perlin::DrawControls(ImDrawList *drawList)
 {
+    bool changed = false;
+
     if (ImGui::SliderInt("##seed", (int *)&seed, 0, std::numeric_limits<int>::max() - 1, "Seed %.0f")) {
         noise.Seed(seed);
+        changed = true;
+    }
+    changed |= ImGui::SliderInt("##octaves", (int *)&octaves, 1, 10, "Octaves %.0f");
+    changed |= ImGui::SliderFloat("##frequency", &frequency, 0.0f, 64.0f, "Frequency %.3f");
+    changed |= ImGui::SliderFloat("##persistence", &persistence, 0.0f, 8.0f, "Persistence %.3f");
+    changed |= ImGui::SliderFloat("##lacunarity", &lacunarity, 0.0f, 8.0f, "Lacunarity %.3f");
+    if (ImGui::Checkbox("Hashed lattice", &hashedLattice)) {
+        noise.HashedLattice(hashedLattice);
+        changed = true;
     }
-    ImGui::SliderInt("##octaves", (int *)&octaves, 1, 10, "Octaves %.0f");
-    ImGui::SliderFloat("##frequency", &frequency, 0.0f, 64.0f, "Frequency %.3f");
-    ImGui::SliderFloat("##persistence", &persistence, 0.0f, 8.0f, "Persistence %.3f");
-    ImGui::SliderFloat("##lacunarity", &lacunarity, 0.0f, 8.0f, "Lacunarity %.3f");
 
     if ((ImGui::Combo("##style", &currentStyleIdx, perlinComboItems, 3))) {
         switch(currentStyleIdx) {
@@ -171,6 +282,11 @@ void Perlin::DrawControls(ImDrawList *drawList)
             case 1: style = Perlin::Billowy; break;
             case 2: style = Perlin::Ridged; break;
         }
+        changed = true;
+    }
+
+    if (changed) {
+        Touch();
     }
 }
 
@@ -181,19 +297,255 @@ void Perlin::Reset()
     frequency = 1.0f;
     persistence = 0.5f;
     lacunarity = 2.0f;
+    hashedLattice = false;
+    noise.HashedLattice(false);
     style = Perlin::Classic;
     currentStyleIdx = 0;
 }
 
+float Simplex::Evaluate(float x, float y, float z) const
+{
+    float p = noise.Sample(x, y, z, octaves, frequency, persistence, lacunarity);
+    return style((p + 1.0f) / 2.0f);
+}
+
+void Simplex::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    noise.Sample(x, y, z, out, count, octaves, frequency, persistence, lacunarity);
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = style((out[i] + 1.0f) / 2.0f);
+    }
+}
+
+unsigned Simplex::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(Opcode::Simplex);
+    instruction.params[0] = frequency;
+    instruction.params[1] = persistence;
+    instruction.params[2] = lacunarity;
+    instruction.octaves = octaves;
+    instruction.style = style;
+    instruction.resource = compiler.AddNoise(noise);
+    return compiler.Emit(instruction);
+}
+
+void Simplex::DrawControls(ImDrawList *drawList)
+{
+    bool changed = false;
+
+    if (ImGui::SliderInt("##seed", (int *)&seed, 0, std::numeric_limits<int>::max() - 1, "Seed %.0f")) {
+        noise.Seed(seed);
+        changed = true;
+    }
+    changed |= ImGui::SliderInt("##octaves", (int *)&octaves, 1, 10, "Octaves %.0f");
+    changed |= ImGui::SliderFloat("##frequency", &frequency, 0.0f, 64.0f, "Frequency %.3f");
+    changed |= ImGui::SliderFloat("##persistence", &persistence, 0.0f, 8.0f, "Persistence %.3f");
+    changed |= ImGui::SliderFloat("##lacunarity", &lacunarity, 0.0f, 8.0f, "Lacunarity %.3f");
+
+    if ((ImGui::Combo("##style", &currentStyleIdx, perlinComboItems, 3))) {
+        switch(currentStyleIdx) {
+            case 0: style = Perlin::Classic; break;
+            case 1: style = Perlin::Billowy; break;
+            case 2: style = Perlin::Ridged; break;
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        Touch();
+    }
+}
+
+void Simplex::Reset()
+{
+    seed = 0;
+    noise.Seed(seed);
+    octaves = 3;
+    frequency = 1.0f;
+    persistence = 0.5f;
+    lacunarity = 2.0f;
+    style = Perlin::Classic;
+    currentStyleIdx = 0;
+}
+
+float Spectral::Evaluate(float x, float y, float z) const
+{
+    return style((noise.Sample(x, y) + 1.0f) / 2.0f);
+}
+
+void Spectral::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    noise.Sample(x, y, out, count);
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = style((out[i] + 1.0f) / 2.0f);
+    }
+}
+
+unsigned Spectral::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(Opcode::Spectral);
+    instruction.style = style;
+    instruction.resource = compiler.AddNoise(noise);
+    return compiler.Emit(instruction);
+}
+
+void Spectral::DrawControls(ImDrawList *drawList)
+{
+    bool changed = false;
+
+    if (ImGui::SliderInt("##seed", (int *)&seed, 0, std::numeric_limits<int>::max() - 1, "Seed %.0f")) {
+        noise.Seed(seed);
+        changed = true;
+    }
+
+    // The field only holds so many octaves, fewer the higher the frequency
+    unsigned maxOctaves = noise::SpectralNoise::MaxOctaves(frequency);
+    bool reshaped = false;
+    reshaped |= ImGui::SliderInt("##octaves", (int *)&octaves, 1, maxOctaves, "Octaves %.0f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("At most %u octaves fit in the field at this frequency", maxOctaves);
+    }
+    reshaped |= ImGui::SliderFloat("##frequency", &frequency, 1.0f, 64.0f, "Frequency %.3f");
+    reshaped |= ImGui::SliderFloat("##persistence", &persistence, 0.0f, 8.0f, "Persistence %.3f");
+    if (reshaped) {
+        octaves = std::min(octaves, noise::SpectralNoise::MaxOctaves(frequency));
+        noise.Spectrum(octaves, frequency, persistence);
+        changed = true;
+    }
+
+    if ((ImGui::Combo("##style", &currentStyleIdx, perlinComboItems, 3))) {
+        switch(currentStyleIdx) {
+            case 0: style = Perlin::Classic; break;
+            case 1: style = Perlin::Billowy; break;
+            case 2: style = Perlin::Ridged; break;
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        Touch();
+    }
+}
+
+void Spectral::Reset()
+{
+    seed = 0;
+    octaves = 3;
+    frequency = 1.0f;
+    persistence = 0.5f;
+    noise.Seed(seed);
+    noise.Spectrum(octaves, frequency, persistence);
+    style = Perlin::Classic;
+    currentStyleIdx = 0;
+}
+
+float Voronoi::Evaluate(float x, float y, float z) const
+{
+    if (jittered) {
+        return Select(noise.SampleJittered2D(x, y, frequency), feature);
+    }
+    return Select(noise.SampleFeatures(x, y, z, frequency), feature);
+}
+
+unsigned Voronoi::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(jittered ? Opcode::JitteredVoronoi : Opcode::Voronoi);
+    instruction.params[0] = frequency;
+    instruction.variant = feature;
+    instruction.resource = compiler.AddNoise(noise);
+    return compiler.Emit(instruction);
+}
+
+float Voronoi::Select(const noise::VoronoiNoise::Features &features, Feature feature)
+{
+    switch (feature) {
+        case F1: return clamp(features.f1);
+        case F2: return clamp(features.f2);
+        case F2MinusF1: return clamp(features.f2 - features.f1);
+        case CellID: return features.cell;
+        default: return 0.0f;
+    }
+}
+
+const char *voronoiMetricItems[] = {
+    "Euclidean", "Manhattan", "Chebyshev"
+};
+
+const char *voronoiFeatureItems[] = {
+    "F1", "F2", "F2 - F1", "Cell ID"
+};
+
+void Voronoi::DrawControls(ImDrawList *drawList)
+{
+    bool changed = false;
+
+    if (ImGui::SliderInt("##seed", (int *)&seed, 0, std::numeric_limits<int>::max() - 1, "Seed %.0f")) {
+        noise.Seed(seed);
+        changed = true;
+    }
+    changed |= ImGui::SliderFloat("##frequency", &frequency, 0.0f, 64.0f, "Frequency %.3f");
+
+    if (ImGui::Combo("##metric", &currentMetricIdx, voronoiMetricItems, 3)) {
+        switch (currentMetricIdx) {
+            case 0: noise.distance = noise::VoronoiNoise::Euclidean; break;
+            case 1: noise.distance = noise::VoronoiNoise::Manhattan; break;
+            case 2: noise.distance = noise::VoronoiNoise::Chebyshev; break;
+        }
+        changed = true;
+    }
+    changed |= ImGui::Combo("##feature", (int *)&feature, voronoiFeatureItems, 4);
+    changed |= ImGui::Checkbox("Jittered", &jittered);
+    if (ImGui::Checkbox("Hashed lattice", &hashedLattice)) {
+        noise.HashedLattice(hashedLattice);
+        changed = true;
+    }
+
+    if (changed) {
+        Touch();
+    }
+}
+
+void Voronoi::Reset()
+{
+    seed = 0;
+    noise.Seed(seed);
+    frequency = 8.0f;
+    feature = F1;
+    jittered = false;
+    hashedLattice = false;
+    noise.HashedLattice(false);
+    noise.distance = noise::VoronoiNoise::Euclidean;
+    currentMetricIdx = 0;
+}
 
 float Constant::Evaluate(float x, float y, float z) const
 {
     return value;
 }
 
+void Constant::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    std::fill(out, out + count, value);
+}
+
+float Constant::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    dx = dy = 0.0f;
+    return value;
+}
+
+unsigned Constant::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(Opcode::Constant);
+    instruction.params[0] = value;
+    return compiler.Emit(instruction);
+}
+
 void Constant::DrawControls(ImDrawList *drawList)
 {
-    ImGui::SliderFloat("##value", &value, 0.0f, 1.0f, "Value %.3f");
+    if (ImGui::SliderFloat("##value", &value, 0.0f, 1.0f, "Value %.3f")) {
+        Touch();
+    }
 }
 
 void Constant::Reset()
@@ -206,10 +558,25 @@ float Gradient::Evaluate(float x, float y, float z) const
     return 0.0f;
 }
 
+float Gradient::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    dx = dy = 0.0f;
+    return 0.0f;
+}
+
+unsigned Gradient::Compile(NodeCompiler &compiler) const
+{
+    return compiler.Emit(Instruction(Opcode::Constant));
+}
+
 void Gradient::DrawControls(ImDrawList *drawList)
 {
-    ImGui::DragFloat2("Start", (float *)&start, 0.1f, 0.0f, 1.0f);
-    ImGui::DragFloat2("End", (float *)&end, 0.1f, 0.0f, 1.0f);
+    bool changed = false;
+    changed |= ImGui::DragFloat2("Start", (float *)&start, 0.1f, 0.0f, 1.0f);
+    changed |= ImGui::DragFloat2("End", (float *)&end, 0.1f, 0.0f, 1.0f);
+    if (changed) {
+        Touch();
+    }
 
     float size = 100.0f;
     ImVec2 min = ImGui::GetCursorScreenPos();
@@ -231,20 +598,91 @@ void Gradient::Reset()
 
 float Abs::Evaluate(float x, float y, float z) const
 {
-    const Node *in = InputSlot(0).toNode;
+    const Node *in = InputNode(0);
 
     if (in) {
-        float v = in->Evaluate(x, y, z);
-        return fabs(v + -0.5f) + 0.5f;
+        return Apply(in->Evaluate(x, y, z));
     } 
     return 0.0f;
 }
 
+void Abs::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        in->EvaluateBlock(x, y, z, out, count);
+        for (unsigned i = 0; i < count; i++) {
+            out[i] = Apply(out[i]);
+        }
+    } else {
+        std::fill(out, out + count, 0.0f);
+    }
+}
+
+float Abs::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        float v = in->EvaluateGradient(x, y, z, dx, dy);
+        dx *= ApplySlope(v);
+        dy *= ApplySlope(v);
+        return Apply(v);
+    }
+    dx = dy = 0.0f;
+    return 0.0f;
+}
+
+unsigned Abs::Compile(NodeCompiler &compiler) const
+{
+    if (!InputNode(0)) {
+        return compiler.Emit(Instruction(Opcode::Constant));
+    }
+    return compiler.Emit(Instruction(Opcode::Abs, compiler.Input(this, 0)));
+}
+
 float Invert::Evaluate(float x, float y, float z) const
 {
-    const Node *in = InputSlot(0).toNode;
+    const Node *in = InputNode(0);
+
+    return  in ? Apply(in->Evaluate(x, y, z)) : 0.0f;
+}
+
+void Invert::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        in->EvaluateBlock(x, y, z, out, count);
+        for (unsigned i = 0; i < count; i++) {
+            out[i] = Apply(out[i]);
+        }
+    } else {
+        std::fill(out, out + count, 0.0f);
+    }
+}
+
+float Invert::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        float v = in->EvaluateGradient(x, y, z, dx, dy);
+        dx = -dx;
+        dy = -dy;
+        return Apply(v);
+    }
+    dx = dy = 0.0f;
+    return 0.0f;
+}
 
-    return  in ? 1.0f - in->Evaluate(x, y, z) : 0.0f;
+unsigned Invert::Compile(NodeCompiler &compiler) const
+{
+    if (!InputNode(0)) {
+        return compiler.Emit(Instruction(Opcode::Constant));
+    }
+    return compiler.Emit(Instruction(Opcode::Invert, compiler.Input(this, 0)));
 }
 
 void Selector::Reset()
@@ -256,57 +694,240 @@ void Selector::Reset()
 
 void Selector::DrawControls(ImDrawList *drawList)
 {
-    ImGui::DragFloatRange2("##range", &min, &max, 0.01, 0.0f, 1.0f);
-    ImGui::SliderFloat("##falloff", &falloff, 0.0f, 1.0f, "Falloff %.3f");
+    bool changed = false;
+    changed |= ImGui::DragFloatRange2("##range", &min, &max, 0.01, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("##falloff", &falloff, 0.0f, 1.0f, "Falloff %.3f");
+    if (changed) {
+        Touch();
+    }
+}
+
+float Selector::Select(float v, float min, float max, float falloff)
+{
+    float fuzz = (max - min) * (1.0f - falloff);
+    if (v < min) {
+        float d = min - v;
+        if (d <= fuzz) {
+            return 1.0f - d / fuzz;
+        }
+        return 0.0f;
+    } else if (v > max) {
+        float d = v - max;
+        if (d <= fuzz) {
+            return 1.0f - d / fuzz;
+        }
+        return 0.0f;
+    } else {
+        return 1.0f;
+    }
+}
+
+float Selector::SelectSlope(float v, float min, float max, float falloff)
+{
+    float fuzz = (max - min) * (1.0f - falloff);
+    if (v < min) {
+        return min - v <= fuzz ? 1.0f / fuzz : 0.0f;
+    } else if (v > max) {
+        return v - max <= fuzz ? -1.0f / fuzz : 0.0f;
+    } else {
+        return 0.0f;
+    }
 }
 
 float Selector::Evaluate(float x, float y, float z) const
 {
-    Node *in = InputSlot(0).toNode;
+    const Node *in = InputNode(0);
+
+    return in ? Select(in->Evaluate(x, y, z), min, max, falloff) : 0.0f;
+}
+
+void Selector::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    const Node *in = InputNode(0);
 
     if (in) {
-        float v = in->Evaluate(x, y, z);
-        float fuzz = (max - min) * (1.0f - falloff);
-        if (v < min) {
-            float d = min - v;
-            if (d <= fuzz) {
-                return 1.0f - d / fuzz;
-            }
-            return 0.0f;
-        } else if (v > max) {
-            float d = v - max;
-            if (d <= fuzz) {
-                return 1.0f - d / fuzz;
-            }
-            return 0.0f;
-        } else {
-            return 1.0f;
+        in->EvaluateBlock(x, y, z, out, count);
+        for (unsigned i = 0; i < count; i++) {
+            out[i] = Select(out[i], min, max, falloff);
         }
+    } else {
+        std::fill(out, out + count, 0.0f);
+    }
+}
+
+float Selector::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        float v = in->EvaluateGradient(x, y, z, dx, dy);
+        float slope = SelectSlope(v, min, max, falloff);
+        dx *= slope;
+        dy *= slope;
+        return Select(v, min, max, falloff);
+    }
+    dx = dy = 0.0f;
+    return 0.0f;
+}
+
+unsigned Selector::Compile(NodeCompiler &compiler) const
+{
+    if (!InputNode(0)) {
+        return compiler.Emit(Instruction(Opcode::Constant));
+    }
+    Instruction instruction(Opcode::Selector, compiler.Input(this, 0));
+    instruction.params[0] = min;
+    instruction.params[1] = max;
+    instruction.params[2] = falloff;
+    return compiler.Emit(instruction);
+}
+
+void Slope::Reset()
+{
+    height = 0.25f;
+    channel = Steepness;
+}
+
+const char *slopeChannelItems[] = {
+    "Steepness", "Normal X", "Normal Y", "Normal Z"
+};
+
+void Slope::DrawControls(ImDrawList *drawList)
+{
+    bool changed = ImGui::SliderFloat("##height", &height, 0.0f, 4.0f, "Height %.3f");
+    changed |= ImGui::Combo("##channel", (int *)&channel, slopeChannelItems, 4);
+
+    if (changed) {
+        Touch();
+    }
+}
+
+float Slope::Shade(float dx, float dy, float height, Channel channel)
+{
+    float nx = -dx * height, ny = -dy * height;
+    float length = sqrtf(nx * nx + ny * ny + 1.0f);
+
+    switch (channel) {
+        case Steepness: return atanf(sqrtf(nx * nx + ny * ny)) / 1.5707964f;
+        case NormalX: return nx / length * 0.5f + 0.5f;
+        case NormalY: return ny / length * 0.5f + 0.5f;
+        case NormalZ: return 1.0f / length * 0.5f + 0.5f;
+        default: return 0.0f;
+    }
+}
+
+float Slope::Evaluate(float x, float y, float z) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        float dx, dy;
+        in->EvaluateGradient(x, y, z, dx, dy);
+        return Shade(dx, dy, height, channel);
     }
     return 0.0f;
 }
 
+float Slope::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    dx = dy = 0.0f;
+    return Evaluate(x, y, z);
+}
+
+unsigned Slope::Compile(NodeCompiler &compiler) const
+{
+    if (!InputNode(0)) {
+        return compiler.Emit(Instruction(Opcode::Constant));
+    }
+    Instruction instruction(Opcode::Slope, compiler.Input(this, 0));
+    instruction.params[0] = height;
+    instruction.variant = channel;
+    return compiler.Emit(instruction);
+}
+
 float Combine::Evaluate(float x, float y, float z) const
 {
-    const Node *in1 = InputSlot(0).toNode;
-    const Node *in2 = InputSlot(1).toNode;
+    const Node *in1 = InputNode(0);
+    const Node *in2 = InputNode(1);
 
     return  clamp(func((in1 ? in1->Evaluate(x, y, z) : 0.0f), (in2 ? in2->Evaluate(x, y, z) * strength : 0.0f)));
 }
 
+void Combine::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    const Node *in1 = InputNode(0);
+    const Node *in2 = InputNode(1);
+
+    std::vector<float> a(count, 0.0f), b(count, 0.0f);
+    if (in1) {
+        in1->EvaluateBlock(x, y, z, a.data(), count);
+    }
+    if (in2) {
+        in2->EvaluateBlock(x, y, z, b.data(), count);
+        for (unsigned i = 0; i < count; i++) {
+            b[i] *= strength;
+        }
+    }
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = clamp(func(a[i], b[i]));
+    }
+}
+
+float Combine::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    const Node *in1 = InputNode(0);
+    const Node *in2 = InputNode(1);
+
+    float a = 0.0f, adx = 0.0f, ady = 0.0f;
+    float b = 0.0f, bdx = 0.0f, bdy = 0.0f;
+    if (in1) {
+        a = in1->EvaluateGradient(x, y, z, adx, ady);
+    }
+    if (in2) {
+        b = in2->EvaluateGradient(x, y, z, bdx, bdy) * strength;
+        bdx *= strength;
+        bdy *= strength;
+    }
+
+    // Flat wherever the result is clamped
+    float v = func(a, b);
+    if (v < 0.0f || v > 1.0f) {
+        dx = dy = 0.0f;
+    } else if (func == Combine::Multiply) {
+        dx = MultiplySlope(a, b, adx, bdx);
+        dy = MultiplySlope(a, b, ady, bdy);
+    } else {
+        dx = AddSlope(a, b, adx, bdx);
+        dy = AddSlope(a, b, ady, bdy);
+    }
+    return clamp(v);
+}
+
+unsigned Combine::Compile(NodeCompiler &compiler) const
+{
+    Instruction instruction(func == Combine::Multiply ? Opcode::Multiply : Opcode::Add, compiler.Input(this, 0), compiler.Input(this, 1));
+    instruction.params[0] = strength;
+    return compiler.Emit(instruction);
+}
+
 const char *combineComboItems[] = {
     "Add", "Multiply"
 };
 
 void Combine::DrawControls(ImDrawList *drawList)
 {
-    ImGui::SliderFloat("##strength", &strength, 0.0f, 2.0f, "Strength %.3f");
+    bool changed = ImGui::SliderFloat("##strength", &strength, 0.0f, 2.0f, "Strength %.3f");
 
     if (ImGui::Combo("##function", &currentFuncIdx, combineComboItems, 2)) {
         switch (currentFuncIdx) {
             case 0: func = Combine::Add; break;
             case 1: func = Combine::Multiply; break;
         }
+        changed = true;
+    }
+
+    if (changed) {
+        Touch();
     }
 }
 
@@ -319,24 +940,65 @@ void Combine::Reset()
 
 float ImageOutput::Evaluate(float x, float y, float z) const
 {
-    Node *in = InputSlot(0).toNode;
+    const Node *in = InputNode(0);
     return in ? in->Evaluate(x, y, z) : 0.0f;
 }
 
+void ImageOutput::EvaluateBlock(const float *x, const float *y, const float *z, float *out, unsigned count) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        in->EvaluateBlock(x, y, z, out, count);
+    } else {
+        std::fill(out, out + count, 0.0f);
+    }
+}
+
+float ImageOutput::EvaluateGradient(float x, float y, float z, float &dx, float &dy) const
+{
+    const Node *in = InputNode(0);
+
+    if (in) {
+        return in->EvaluateGradient(x, y, z, dx, dy);
+    }
+    dx = dy = 0.0f;
+    return 0.0f;
+}
+
+unsigned ImageOutput::Compile(NodeCompiler &compiler) const
+{
+    return compiler.Input(this, 0);
+}
+
 void ImageOutput::Reset()
 {
     memset(buffer, 0, 128);
     buffer[0] = '\0';
     imageSize = 512;
+    native = false;
+    nativeFailed = false;
+    fixedPoint = false;
 }
 
 void ImageOutput::DrawControls(ImDrawList *drawList)
 {
     ImGui::InputText("Filename", buffer, 128);
     ImGui::SliderInt("Image Size", (int *)&imageSize, 1, 8192, "%.0f");
+    ImGui::Checkbox("Native code", &native);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Builds the graph with the system compiler on the first save, which takes a few seconds");
+    }
+    ImGui::Checkbox("Fixed point", &fixedPoint);
     if (ImGui::Button("Save")) {
+        NodeProgram program = NodeCompiler::Compile(this);
+        nativeFailed = native && !program.CompileNative();
         NodeRenderer renderer(imageSize);
-        const NodeRenderer::ImageData image = renderer.Render(this);
+        renderer.FixedPoint(fixedPoint);
+        const NodeRenderer::ImageData image = renderer.Render(program);
         lodepng::encode(std::string(buffer) + ".png", image, imageSize, imageSize, LCT_RGB, 8);
     }
+    if (native && nativeFailed) {
+        ImGui::Text("Native code unavailable, saved with the interpreter");
+    }
 }
\ No newline at end of file
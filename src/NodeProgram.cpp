@@ -0,0 +1,961 @@
+#include "NodeProgram.h"
+#include "Node.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+const unsigned NodeProgram::BlockSize;
+
+static unsigned SourceCount(Opcode op)
+{
+    switch (op) {
+        case Opcode::Abs:
+        case Opcode::Invert:
+        case Opcode::Selector:
+        case Opcode::Slope:
+            return 1;
+        case Opcode::Add:
+        case Opcode::Multiply:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+void NodeProgram::Run(const float *x, const float *y, const float *z, float *out, unsigned count, float spacing) const
+{
+    std::vector<float> registers(registerCount * BlockSize);
+    std::vector<float> slopes(gradients ? registerCount * 2 * BlockSize : 0);
+
+    for (unsigned i = 0; i < count; i += BlockSize) {
+        unsigned n = std::min(BlockSize, count - i);
+        RunBlock(x + i, y + i, z ? z + i : nullptr, registers.data(), gradients ? slopes.data() : nullptr, n, spacing);
+
+        const float *result = &registers[output * BlockSize];
+        std::copy(result, result + n, out + i);
+    }
+}
+
+void NodeProgram::Run(const float *x, const float *y, float z, float *out, unsigned count, float spacing) const
+{
+    if (z == 0.0f) {
+        Run(x, y, nullptr, out, count, spacing);
+    } else {
+        std::vector<float> zs(count, z);
+        Run(x, y, zs.data(), out, count, spacing);
+    }
+}
+
+void NodeProgram::RunGrid(const float *x, unsigned width, const float *y, unsigned height, float z, float *out, float spacing) const
+{
+    unsigned rows = width ? BlockSize / width : 0;
+    if (rows == 0) {
+        // Rows longer than a block are split across blocks, run them as plain points
+        std::vector<float> xs(width * height), ys(width * height);
+        for (unsigned j = 0, k = 0; j < height; j++) {
+            for (unsigned i = 0; i < width; i++, k++) {
+                xs[k] = x[i];
+                ys[k] = y[j];
+            }
+        }
+        Run(xs.data(), ys.data(), z, out, width * height, spacing);
+        return;
+    }
+
+    std::vector<float> registers(registerCount * BlockSize);
+    std::vector<float> slopes(gradients ? registerCount * 2 * BlockSize : 0);
+    std::vector<float> xs(rows * width), ys(rows * width), zs(rows * width, z);
+
+    for (unsigned k = 0; k < rows * width; k++) {
+        xs[k] = x[k % width];
+    }
+
+    for (unsigned j = 0; j < height; j += rows) {
+        GridRows grid = { x, width, y + j, std::min(rows, height - j), z };
+        unsigned n = grid.height * width;
+        for (unsigned k = 0; k < n; k++) {
+            ys[k] = grid.y[k / width];
+        }
+        RunBlock(xs.data(), ys.data(), z == 0.0f ? nullptr : zs.data(), registers.data(), gradients ? slopes.data() : nullptr, n, spacing, &grid);
+
+        const float *result = &registers[output * BlockSize];
+        std::copy(result, result + n, out + j * width);
+    }
+}
+
+bool NodeProgram::RunGridFixed(float x0, float dx, unsigned width, float y0, float dy, unsigned height, uint8_t *out, float spacing) const
+{
+    if (instructions.size() != 1) {
+        return false;
+    }
+    const Instruction &instruction = instructions[0];
+    if (instruction.op != Opcode::Perlin || instruction.style != Perlin::Classic) {
+        return false;
+    }
+
+    const float *params = instruction.params;
+    perlin[instruction.resource].SampleGridFixed(x0, y0, dx, dy, width, height, out, instruction.octaves, params[0], params[1], params[2], spacing);
+    return true;
+}
+
+// Bounds of f over [*min, *max] for functions monotonic on either side of 0.5, like the styles and Abs
+static void FoldRange(float (*f)(float), float *min, float *max)
+{
+    float a = f(*min), b = f(*max);
+    float lo = std::min(a, b), hi = std::max(a, b);
+    if (*min < 0.5f && *max > 0.5f) {
+        lo = std::min(lo, f(0.5f));
+        hi = std::max(hi, f(0.5f));
+    }
+    *min = lo;
+    *max = hi;
+}
+
+static void StyleRange(Instruction::StyleFunc style, float *min, float *max)
+{
+    *min = (*min + 1.0f) / 2.0f;
+    *max = (*max + 1.0f) / 2.0f;
+    FoldRange(style, min, max);
+}
+
+// Results of a combine lie in the clamp of their bounds, an undefined bound leaves all of [0, 1]
+static void ClampRange(float *min, float *max)
+{
+    *min = std::isnan(*min) ? 0.0f : clamp(*min);
+    *max = std::isnan(*max) ? 1.0f : clamp(*max);
+}
+
+// Values are finite at run time, only their bounds may not be, so a zero factor always gives zero
+static float RangeProduct(float a, float b)
+{
+    return a == 0.0f || b == 0.0f ? 0.0f : a * b;
+}
+
+void NodeProgram::Range(float x0, float y0, float x1, float y1, float z, float *min, float *max, float spacing) const
+{
+    std::vector<float> lo(registerCount), hi(registerCount);
+
+    unsigned range = 0;
+    for (unsigned k = 0; k < instructions.size(); k++) {
+        // Copies made for masked ranges hold the values of their inputs
+        for (; range < masked.size() && masked[range].begin == k; range++) {
+            for (unsigned j = 0; j < masked[range].inputs.size(); j++) {
+                lo[masked[range].copies[j]] = lo[masked[range].inputs[j]];
+                hi[masked[range].copies[j]] = hi[masked[range].inputs[j]];
+            }
+        }
+
+        const Instruction &instruction = instructions[k];
+        InstructionRange(instruction, lo.data(), hi.data(), x0, y0, x1, y1, z, spacing, &lo[instruction.dst], &hi[instruction.dst]);
+    }
+
+    *min = lo[output];
+    *max = hi[output];
+}
+
+void NodeProgram::InstructionRange(const Instruction &instruction, const float *lo, const float *hi, float x0, float y0, float x1, float y1, float z, float spacing, float *min, float *max) const
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float *params = instruction.params;
+    float a0 = lo[instruction.src[0]], a1 = hi[instruction.src[0]];
+    float b0 = lo[instruction.src[1]], b1 = hi[instruction.src[1]];
+    float &dst0 = *min, &dst1 = *max;
+
+    switch (instruction.op) {
+        case Opcode::Perlin:
+            perlin[instruction.resource].Range(x0, y0, x1, y1, z, &dst0, &dst1, instruction.octaves, params[0], params[1], params[2], spacing);
+            StyleRange(instruction.style, &dst0, &dst1);
+            break;
+        case Opcode::Simplex:
+            dst0 = -infinity;
+            dst1 = infinity;
+            StyleRange(instruction.style, &dst0, &dst1);
+            break;
+        case Opcode::Spectral:
+            dst0 = -1.0f;
+            dst1 = 1.0f;
+            StyleRange(instruction.style, &dst0, &dst1);
+            break;
+        case Opcode::Voronoi:
+        case Opcode::JitteredVoronoi:
+        case Opcode::Slope:
+            dst0 = 0.0f;
+            dst1 = 1.0f;
+            break;
+        case Opcode::Constant:
+            dst0 = dst1 = params[0];
+            break;
+        case Opcode::Abs:
+            dst0 = a0;
+            dst1 = a1;
+            FoldRange(Abs::Apply, &dst0, &dst1);
+            break;
+        case Opcode::Invert:
+            dst0 = Invert::Apply(a1);
+            dst1 = Invert::Apply(a0);
+            break;
+        case Opcode::Selector: {
+            // Rises to the plateau between min and max and falls after it
+            float s0 = Selector::Select(a0, params[0], params[1], params[2]);
+            float s1 = Selector::Select(a1, params[0], params[1], params[2]);
+            bool plateau = a0 <= params[1] && a1 >= params[0] && params[0] <= params[1];
+            dst0 = std::min(s0, s1);
+            dst1 = plateau ? 1.0f : std::max(s0, s1);
+            break;
+        }
+        case Opcode::Add: {
+            float c0 = RangeProduct(b0, params[0]), c1 = RangeProduct(b1, params[0]);
+            dst0 = Combine::Add(a0, std::min(c0, c1));
+            dst1 = Combine::Add(a1, std::max(c0, c1));
+            ClampRange(&dst0, &dst1);
+            break;
+        }
+        case Opcode::Multiply: {
+            float c0 = RangeProduct(b0, params[0]), c1 = RangeProduct(b1, params[0]);
+            float products[4] = { RangeProduct(a0, c0), RangeProduct(a0, c1), RangeProduct(a1, c0), RangeProduct(a1, c1) };
+            dst0 = *std::min_element(products, products + 4);
+            dst1 = *std::max_element(products, products + 4);
+            for (float product : products) {
+                if (std::isnan(product)) {
+                    dst0 = dst1 = std::numeric_limits<float>::quiet_NaN();
+                }
+            }
+            ClampRange(&dst0, &dst1);
+            break;
+        }
+    }
+}
+
+void NodeProgram::RunBlock(const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid) const
+{
+    if (native) {
+        RunNative(x, y, z, registers, count, spacing, grid);
+        return;
+    }
+    RunRange(0, instructions.size(), 0, x, y, z, registers, gradients, count, spacing, grid);
+}
+
+unsigned NodeProgram::RunMasked(unsigned range, const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid) const
+{
+    const MaskedRange &current = masked[range];
+    const Instruction &multiply = instructions[current.end];
+    const float *mask = registers + multiply.src[current.mask] * BlockSize;
+    float *result = registers + multiply.src[1 - current.mask] * BlockSize;
+
+    unsigned next = range + 1;
+    while (next < masked.size() && masked[next].begin < current.end) {
+        next++;
+    }
+
+    unsigned lanes[BlockSize];
+    unsigned active = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (mask[i] != 0.0f) {
+            lanes[active++] = i;
+        }
+    }
+    if (active == 0) {
+        std::fill(result, result + count, 0.0f);
+        return next;
+    }
+
+    for (unsigned j = 0; j < current.inputs.size(); j++) {
+        const float *input = registers + current.inputs[j] * BlockSize;
+        float *copy = registers + current.copies[j] * BlockSize;
+        for (unsigned i = 0; i < active; i++) {
+            copy[i] = input[lanes[i]];
+        }
+        if (gradients) {
+            const float *slopes = gradients + current.inputs[j] * 2 * BlockSize;
+            float *copied = gradients + current.copies[j] * 2 * BlockSize;
+            for (unsigned i = 0; i < active; i++) {
+                copied[i] = slopes[lanes[i]];
+                copied[i + BlockSize] = slopes[lanes[i] + BlockSize];
+            }
+        }
+    }
+
+    if (active == count) {
+        RunRange(current.begin, current.end, range + 1, x, y, z, registers, gradients, count, spacing, grid);
+        return next;
+    }
+
+    float xs[BlockSize], ys[BlockSize], zs[BlockSize];
+    for (unsigned i = 0; i < active; i++) {
+        xs[i] = x[lanes[i]];
+        ys[i] = y[lanes[i]];
+        zs[i] = z ? z[lanes[i]] : 0.0f;
+    }
+    RunRange(current.begin, current.end, range + 1, xs, ys, z ? zs : nullptr, registers, gradients, active, spacing, nullptr);
+
+    // Unpacked from the back, a lane only ever moves up
+    for (unsigned i = count, k = active; i-- > 0;) {
+        result[i] = k > 0 && lanes[k - 1] == i ? result[--k] : 0.0f;
+    }
+    return next;
+}
+
+void NodeProgram::RunRange(unsigned begin, unsigned end, unsigned range, const float *x, const float *y, const float *z, float *registers, float *gradients, unsigned count, float spacing, const GridRows *grid) const
+{
+    for (unsigned k = begin; k < end;) {
+        if (range < masked.size() && masked[range].begin == k) {
+            k = masked[range].end;
+            range = RunMasked(range, x, y, z, registers, gradients, count, spacing, grid);
+            continue;
+        }
+
+        const Instruction &instruction = instructions[k++];
+        float *dst = registers + instruction.dst * BlockSize;
+        const float *a = registers + instruction.src[0] * BlockSize;
+        const float *b = registers + instruction.src[1] * BlockSize;
+        const float *params = instruction.params;
+
+        // Slopes of the destination and sources, only meaningful for instructions that track them
+        float *dx = nullptr, *dy = nullptr;
+        const float *ax = nullptr, *ay = nullptr, *bx = nullptr, *by = nullptr;
+        if (gradients) {
+            dx = gradients + instruction.dst * 2 * BlockSize;
+            dy = dx + BlockSize;
+            ax = gradients + instruction.src[0] * 2 * BlockSize;
+            ay = ax + BlockSize;
+            bx = gradients + instruction.src[1] * 2 * BlockSize;
+            by = bx + BlockSize;
+        }
+
+        switch (instruction.op) {
+            case Opcode::Perlin:
+                if (instruction.gradient) {
+                    perlin[instruction.resource].SampleGradient(x, y, z, dst, dx, dy, count, instruction.octaves, params[0], params[1], params[2], spacing);
+                    for (unsigned i = 0; i < count; i++) {
+                        float v = (dst[i] + 1.0f) / 2.0f;
+                        float slope = Perlin::StyleSlope(instruction.style, v) / 2.0f;
+                        dst[i] = instruction.style(v);
+                        dx[i] *= slope;
+                        dy[i] *= slope;
+                    }
+                    break;
+                }
+                Generate(instruction, x, y, z, dst, count, spacing, grid);
+                break;
+            case Opcode::Simplex:
+            case Opcode::Spectral:
+            case Opcode::Voronoi:
+            case Opcode::JitteredVoronoi:
+            case Opcode::Constant:
+                Generate(instruction, x, y, z, dst, count, spacing);
+                if (instruction.gradient) {
+                    Differentiate(instruction, x, y, z, dst, dx, dy, count, spacing);
+                }
+                break;
+            case Opcode::Abs:
+                // The destination may share its register with the source, so slopes go first
+                if (instruction.gradient) {
+                    for (unsigned i = 0; i < count; i++) {
+                        dx[i] = ax[i] * Abs::ApplySlope(a[i]);
+                        dy[i] = ay[i] * Abs::ApplySlope(a[i]);
+                    }
+                }
+                for (unsigned i = 0; i < count; i++) {
+                    dst[i] = Abs::Apply(a[i]);
+                }
+                break;
+            case Opcode::Invert:
+                for (unsigned i = 0; i < count; i++) {
+                    dst[i] = Invert::Apply(a[i]);
+                }
+                if (instruction.gradient) {
+                    for (unsigned i = 0; i < count; i++) {
+                        dx[i] = -ax[i];
+                        dy[i] = -ay[i];
+                    }
+                }
+                break;
+            case Opcode::Selector:
+                if (instruction.gradient) {
+                    for (unsigned i = 0; i < count; i++) {
+                        float slope = Selector::SelectSlope(a[i], params[0], params[1], params[2]);
+                        dx[i] = ax[i] * slope;
+                        dy[i] = ay[i] * slope;
+                    }
+                }
+                for (unsigned i = 0; i < count; i++) {
+                    dst[i] = Selector::Select(a[i], params[0], params[1], params[2]);
+                }
+                break;
+            case Opcode::Add:
+                for (unsigned i = 0; i < count; i++) {
+                    float v = Combine::Add(a[i], b[i] * params[0]);
+                    if (instruction.gradient) {
+                        bool flat = v < 0.0f || v > 1.0f;
+                        dx[i] = flat ? 0.0f : Combine::AddSlope(a[i], b[i] * params[0], ax[i], bx[i] * params[0]);
+                        dy[i] = flat ? 0.0f : Combine::AddSlope(a[i], b[i] * params[0], ay[i], by[i] * params[0]);
+                    }
+                    dst[i] = clamp(v);
+                }
+                break;
+            case Opcode::Multiply:
+                for (unsigned i = 0; i < count; i++) {
+                    float v = Combine::Multiply(a[i], b[i] * params[0]);
+                    if (instruction.gradient) {
+                        bool flat = v < 0.0f || v > 1.0f;
+                        dx[i] = flat ? 0.0f : Combine::MultiplySlope(a[i], b[i] * params[0], ax[i], bx[i] * params[0]);
+                        dy[i] = flat ? 0.0f : Combine::MultiplySlope(a[i], b[i] * params[0], ay[i], by[i] * params[0]);
+                    }
+                    dst[i] = clamp(v);
+                }
+                break;
+            case Opcode::Slope:
+                for (unsigned i = 0; i < count; i++) {
+                    dst[i] = Slope::Shade(ax[i], ay[i], params[0], (Slope::Channel)instruction.variant);
+                }
+                if (instruction.gradient) {
+                    std::fill(dx, dx + count, 0.0f);
+                    std::fill(dy, dy + count, 0.0f);
+                }
+                break;
+        }
+    }
+}
+
+void NodeProgram::Generate(const Instruction &instruction, const float *x, const float *y, const float *z, float *dst, unsigned count, float spacing, const GridRows *grid) const
+{
+    const float *params = instruction.params;
+
+    switch (instruction.op) {
+        case Opcode::Perlin:
+            if (grid) {
+                perlin[instruction.resource].SampleGrid(grid->x, grid->width, grid->y, grid->height, grid->z, dst, instruction.octaves, params[0], params[1], params[2], spacing);
+            } else if (z) {
+                perlin[instruction.resource].Sample(x, y, z, dst, count, instruction.octaves, params[0], params[1], params[2], spacing);
+            } else {
+                perlin[instruction.resource].Sample2D(x, y, dst, count, instruction.octaves, params[0], params[1], params[2], spacing);
+            }
+            for (unsigned i = 0; i < count; i++) {
+                dst[i] = instruction.style((dst[i] + 1.0f) / 2.0f);
+            }
+            break;
+        case Opcode::Simplex:
+            simplex[instruction.resource].Sample(x, y, z, dst, count, instruction.octaves, params[0], params[1], params[2], spacing);
+            for (unsigned i = 0; i < count; i++) {
+                dst[i] = instruction.style((dst[i] + 1.0f) / 2.0f);
+            }
+            break;
+        case Opcode::Spectral:
+            spectral[instruction.resource].Sample(x, y, dst, count);
+            for (unsigned i = 0; i < count; i++) {
+                dst[i] = instruction.style((dst[i] + 1.0f) / 2.0f);
+            }
+            break;
+        case Opcode::Voronoi:
+        case Opcode::JitteredVoronoi: {
+            noise::VoronoiNoise::Features features[BlockSize];
+            if (instruction.op == Opcode::Voronoi) {
+                voronoi[instruction.resource].SampleFeatures(x, y, z, features, count, params[0]);
+            } else {
+                voronoi[instruction.resource].SampleJittered2D(x, y, features, count, params[0]);
+            }
+            for (unsigned i = 0; i < count; i++) {
+                dst[i] = Voronoi::Select(features[i], (Voronoi::Feature)instruction.variant);
+            }
+            break;
+        }
+        case Opcode::Constant:
+            std::fill(dst, dst + count, params[0]);
+            break;
+        default:
+            break;
+    }
+}
+
+// Same step and arithmetic as Node::EvaluateGradient, so compiled and evaluated slopes agree
+void NodeProgram::Differentiate(const Instruction &instruction, const float *x, const float *y, const float *z, const float *value, float *dx, float *dy, unsigned count, float spacing) const
+{
+    const float step = Node::GradientStep;
+    float shifted[BlockSize];
+
+    for (unsigned i = 0; i < count; i++) {
+        shifted[i] = x[i] + step;
+    }
+    Generate(instruction, shifted, y, z, dx, count, spacing);
+    for (unsigned i = 0; i < count; i++) {
+        shifted[i] = y[i] + step;
+    }
+    Generate(instruction, x, shifted, z, dy, count, spacing);
+
+    for (unsigned i = 0; i < count; i++) {
+        dx[i] = (dx[i] - value[i]) / step;
+        dy[i] = (dy[i] - value[i]) / step;
+    }
+}
+
+NodeProgram NodeCompiler::Compile(const Node *node)
+{
+    NodeCompiler compiler;
+
+    std::vector<const Node *> order;
+    if (node) {
+        compiler.Sort(node, order);
+    }
+
+    // Dependencies come first in the order, so every input already has a register when a node is emitted
+    for (const Node *n : order) {
+        compiler.registers[n] = n->Compile(compiler);
+    }
+
+    compiler.program.output = node ? compiler.registers[node] : compiler.ZeroRegister();
+    compiler.Optimize();
+    compiler.MarkGradients();
+    compiler.MaskBranches();
+    compiler.AllocateRegisters();
+    compiler.CopyMaskedInputs();
+    return compiler.program;
+}
+
+unsigned NodeCompiler::Input(const Node *node, unsigned slotNum)
+{
+    // Unconnected slots, and links closing a cycle, read as zero
+    auto it = registers.find(node->InputSlot(slotNum).toNode);
+    if (it != registers.end()) {
+        return it->second;
+    }
+    return ZeroRegister();
+}
+
+unsigned NodeCompiler::Emit(Instruction instruction)
+{
+    instruction.dst = program.registerCount++;
+    program.instructions.push_back(instruction);
+    return instruction.dst;
+}
+
+unsigned NodeCompiler::AddNoise(const noise::PerlinNoise &noise)
+{
+    program.perlin.push_back(noise);
+    return program.perlin.size() - 1;
+}
+
+unsigned NodeCompiler::AddNoise(const noise::SimplexNoise &noise)
+{
+    program.simplex.push_back(noise);
+    return program.simplex.size() - 1;
+}
+
+unsigned NodeCompiler::AddNoise(const noise::SpectralNoise &noise)
+{
+    program.spectral.push_back(noise);
+    return program.spectral.size() - 1;
+}
+
+unsigned NodeCompiler::AddNoise(const noise::VoronoiNoise &noise)
+{
+    program.voronoi.push_back(noise);
+    return program.voronoi.size() - 1;
+}
+
+void NodeCompiler::Sort(const Node *node, std::vector<const Node *> &order)
+{
+    visited.insert(node);
+    for (unsigned i = 0; i < node->InputCount(); i++) {
+        const Node *in = node->InputSlot(i).toNode;
+        if (in && visited.find(in) == visited.end()) {
+            Sort(in, order);
+        }
+    }
+    order.push_back(node);
+}
+
+// Maps each noise generator to the first one equal to it
+template <typename Noise>
+static std::vector<unsigned> Canonical(const std::vector<Noise> &noises)
+{
+    std::vector<unsigned> canonical(noises.size());
+    for (unsigned i = 0; i < noises.size(); i++) {
+        canonical[i] = i;
+        for (unsigned j = 0; j < i; j++) {
+            if (noises[j] == noises[i]) {
+                canonical[i] = canonical[j];
+                break;
+            }
+        }
+    }
+    return canonical;
+}
+
+static size_t HashInstruction(const Instruction &instruction)
+{
+    size_t hash = (size_t)instruction.op;
+    auto mix = [&hash](size_t v) { hash ^= v + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+    for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+        mix(instruction.src[j]);
+    }
+    for (float param : instruction.params) {
+        mix(std::hash<float>()(param));
+    }
+    mix(instruction.octaves);
+    mix(instruction.variant);
+    mix(instruction.resource);
+    mix((size_t)instruction.style);
+    return hash;
+}
+
+// Same computation on the same sources, the destinations may differ
+static bool SameInstruction(const Instruction &a, const Instruction &b)
+{
+    if (a.op != b.op || a.octaves != b.octaves || a.variant != b.variant || a.resource != b.resource || a.style != b.style) {
+        return false;
+    }
+    for (unsigned j = 0; j < SourceCount(a.op); j++) {
+        if (a.src[j] != b.src[j]) {
+            return false;
+        }
+    }
+    return std::equal(a.params, a.params + 4, b.params);
+}
+
+// Simplifies the program before registers are shared: instructions whose sources are all constant
+// are folded, no-ops are forwarded to their source, duplicates of an earlier instruction, such as
+// pasted copies of a node, are forwarded to it, and whatever the output no longer depends on is
+// dropped. Works on the virtual registers, the graph itself is left as it is.
+void NodeCompiler::Optimize()
+{
+    std::vector<Instruction> &instructions = program.instructions;
+    const unsigned None = -1;
+
+    // Generators only match when their noise does, compare resources by value
+    std::vector<unsigned> perlin = Canonical(program.perlin);
+    std::vector<unsigned> simplex = Canonical(program.simplex);
+    std::vector<unsigned> voronoi = Canonical(program.voronoi);
+    std::vector<unsigned> spectral = Canonical(program.spectral);
+    for (Instruction &instruction : instructions) {
+        switch (instruction.op) {
+            case Opcode::Perlin: instruction.resource = perlin[instruction.resource]; break;
+            case Opcode::Simplex: instruction.resource = simplex[instruction.resource]; break;
+            case Opcode::Voronoi:
+            case Opcode::JitteredVoronoi: instruction.resource = voronoi[instruction.resource]; break;
+            case Opcode::Spectral: instruction.resource = spectral[instruction.resource]; break;
+            default: break;
+        }
+    }
+    std::unordered_multimap<size_t, unsigned> computed;
+
+    // Instruction writing each register, the register standing in for it, and bounds on its values
+    // anywhere on the plane: Range over a rectangle reaching below zero, which holds everywhere
+    std::vector<unsigned> producer(program.registerCount, None);
+    std::vector<unsigned> alias(program.registerCount);
+    std::vector<float> lower(program.registerCount), upper(program.registerCount);
+    for (unsigned r = 0; r < program.registerCount; r++) {
+        alias[r] = r;
+    }
+
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        Instruction &instruction = instructions[i];
+        unsigned sources = SourceCount(instruction.op);
+
+        const Instruction *in[2] = { nullptr, nullptr };
+        float values[2] = { 0, 0 };
+        bool constant = sources > 0;
+        for (unsigned j = 0; j < sources; j++) {
+            instruction.src[j] = alias[instruction.src[j]];
+            in[j] = &instructions[producer[instruction.src[j]]];
+            values[j] = in[j]->params[0];
+            constant = constant && in[j]->op == Opcode::Constant;
+        }
+
+        Opcode op = instruction.op;
+        unsigned dst = instruction.dst;
+        if (constant) {
+            float value = Fold(instruction, values);
+            instruction = Instruction(Opcode::Constant);
+            instruction.dst = dst;
+            instruction.params[0] = value;
+        } else if (op == Opcode::Invert && in[0]->op == Opcode::Invert && lower[in[0]->src[0]] >= 0.5f && upper[in[0]->src[0]] <= 2.0f) {
+            // 1 - (1 - v) rounds back to v only where 1 - v is exact, which Sterbenz guarantees for v
+            // in [0.5, 2]. Elsewhere a small v would come back as 0.
+            alias[dst] = in[0]->src[0];
+        } else if (op == Opcode::Abs && in[0]->op == Opcode::Abs) {
+            alias[dst] = instruction.src[0];
+        } else if ((op == Opcode::Add || op == Opcode::Multiply) && (instruction.params[0] == 0.0f || (in[1]->op == Opcode::Constant && values[1] == 0.0f))) {
+            // Nothing gets combined in: a product is zero, a sum is its first source clamped, which
+            // is a no-op for sources already in range. Either way the second source is not needed.
+            if (op == Opcode::Multiply) {
+                instruction = Instruction(Opcode::Constant);
+                instruction.dst = dst;
+            } else if (lower[instruction.src[0]] >= 0.0f && upper[instruction.src[0]] <= 1.0f) {
+                alias[dst] = instruction.src[0];
+            } else {
+                instruction.src[1] = instruction.src[0];
+                instruction.params[0] = 0.0f;
+            }
+        }
+
+        if (alias[dst] == dst) {
+            size_t hash = HashInstruction(instruction);
+            auto range = computed.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (SameInstruction(instructions[it->second], instruction)) {
+                    alias[dst] = instructions[it->second].dst;
+                    break;
+                }
+            }
+            if (alias[dst] == dst) {
+                computed.insert(std::make_pair(hash, i));
+            }
+        }
+
+        producer[dst] = i;
+        if (alias[dst] == dst) {
+            program.InstructionRange(instruction, lower.data(), upper.data(), -1, -1, -1, -1, 0, 0, &lower[dst], &upper[dst]);
+        }
+    }
+    program.output = alias[program.output];
+
+    std::vector<bool> live(program.registerCount, false);
+    live[program.output] = true;
+    for (unsigned i = instructions.size(); i-- > 0;) {
+        const Instruction &instruction = instructions[i];
+        if (live[instruction.dst] && alias[instruction.dst] == instruction.dst) {
+            for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+                live[instruction.src[j]] = true;
+            }
+        }
+    }
+    instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [&](const Instruction &instruction) {
+        return !live[instruction.dst] || alias[instruction.dst] != instruction.dst;
+    }), instructions.end());
+}
+
+// Runs the instruction on a single point with its sources loaded as constants, so a folded value is
+// exactly what the program would have computed
+float NodeCompiler::Fold(Instruction instruction, const float *values)
+{
+    NodeProgram program;
+    unsigned sources = SourceCount(instruction.op);
+    for (unsigned j = 0; j < sources; j++) {
+        Instruction constant(Opcode::Constant);
+        constant.dst = j;
+        constant.params[0] = values[j];
+        constant.gradient = instruction.op == Opcode::Slope;
+        program.instructions.push_back(constant);
+        instruction.src[j] = j;
+    }
+    instruction.dst = sources;
+    instruction.gradient = false;
+    program.instructions.push_back(instruction);
+    program.registerCount = sources + 1;
+    program.output = sources;
+    program.gradients = instruction.op == Opcode::Slope;
+
+    float x = 0, y = 0, value;
+    program.Run(&x, &y, 0.0f, &value, 1);
+    return value;
+}
+
+// Flags the instructions whose slopes a Slope instruction reads, directly or through the filters and
+// combiners in between. Works on the virtual registers, before they are shared.
+void NodeCompiler::MarkGradients()
+{
+    std::vector<Instruction> &instructions = program.instructions;
+    std::vector<bool> needed(program.registerCount, false);
+
+    for (unsigned i = instructions.size(); i-- > 0;) {
+        Instruction &instruction = instructions[i];
+        instruction.gradient = needed[instruction.dst];
+        if (instruction.gradient || instruction.op == Opcode::Slope) {
+            for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+                needed[instruction.src[j]] = true;
+            }
+            program.gradients = true;
+        }
+    }
+}
+
+// Gathers the instructions only the unmasked source of a Multiply by a Selector depends on into a
+// range right before the Multiply, so that they can run on the lanes the mask leaves nonzero alone.
+// The rest of the order is kept. Multiplies tracking slopes are left alone, theirs depend on the
+// unmasked source even where the mask is zero.
+void NodeCompiler::MaskBranches()
+{
+    std::vector<Instruction> &instructions = program.instructions;
+    const unsigned None = -1;
+
+    struct Found
+    {
+        unsigned multiply;
+        unsigned size;
+        unsigned mask;
+    };
+    std::vector<Found> found;
+
+    for (unsigned m = 0; m < instructions.size(); m++) {
+        Instruction multiply = instructions[m];
+        if (multiply.op != Opcode::Multiply || multiply.gradient || multiply.src[0] == multiply.src[1]) {
+            continue;
+        }
+
+        std::vector<unsigned> producer(program.registerCount, None), reads(program.registerCount, 0);
+        for (unsigned k = 0; k < instructions.size(); k++) {
+            producer[instructions[k].dst] = k;
+            for (unsigned j = 0; j < SourceCount(instructions[k].op); j++) {
+                reads[instructions[k].src[j]]++;
+            }
+        }
+        reads[program.output]++;
+
+        for (unsigned mask = 0; mask < 2; mask++) {
+            if (instructions[producer[multiply.src[mask]]].op != Opcode::Selector) {
+                continue;
+            }
+
+            // Walking back from the Multiply, an instruction belongs to the range once every read of
+            // its result comes from the range or the Multiply itself
+            std::vector<bool> inside(m, false);
+            std::vector<unsigned> insideReads(program.registerCount, 0);
+            insideReads[multiply.src[1 - mask]]++;
+            unsigned size = 0;
+            bool generator = false;
+            for (unsigned k = m; k-- > 0;) {
+                const Instruction &instruction = instructions[k];
+                if (instruction.dst == multiply.src[mask] || insideReads[instruction.dst] == 0 || insideReads[instruction.dst] != reads[instruction.dst]) {
+                    continue;
+                }
+                inside[k] = true;
+                size++;
+                generator = generator || (SourceCount(instruction.op) == 0 && instruction.op != Opcode::Constant);
+                for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+                    insideReads[instruction.src[j]]++;
+                }
+            }
+            // Packing lanes only pays for itself when the range samples noise
+            if (!generator) {
+                continue;
+            }
+
+            std::vector<Instruction> reordered;
+            reordered.reserve(instructions.size());
+            for (unsigned k = 0; k < m; k++) {
+                if (!inside[k]) {
+                    reordered.push_back(instructions[k]);
+                }
+            }
+            for (unsigned k = 0; k < m; k++) {
+                if (inside[k]) {
+                    reordered.push_back(instructions[k]);
+                }
+            }
+            reordered.insert(reordered.end(), instructions.begin() + m, instructions.end());
+            instructions.swap(reordered);
+
+            found.push_back({ multiply.dst, size, mask });
+            break;
+        }
+    }
+
+    // Later moves shift earlier ranges but keep them whole, so they are located once all are done
+    for (const Found &f : found) {
+        for (unsigned k = 0; k < instructions.size(); k++) {
+            if (instructions[k].dst == f.multiply) {
+                NodeProgram::MaskedRange range;
+                range.begin = k - f.size;
+                range.end = k;
+                range.mask = f.mask;
+                program.masked.push_back(range);
+                break;
+            }
+        }
+    }
+    std::sort(program.masked.begin(), program.masked.end(), [](const NodeProgram::MaskedRange &a, const NodeProgram::MaskedRange &b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    });
+}
+
+// Every node is emitted once no matter how many consumers it has, so a shared value is computed once
+// per block. Map those values onto as few physical registers as possible: a register is kept live
+// until its last consumer has run and is then recycled, which keeps the working set of wide graphs small.
+void NodeCompiler::AllocateRegisters()
+{
+    std::vector<Instruction> &instructions = program.instructions;
+    const unsigned Unused = -1;
+
+    std::vector<unsigned> lastUse(program.registerCount, Unused);
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        const Instruction &instruction = instructions[i];
+        for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+            lastUse[instruction.src[j]] = i;
+        }
+    }
+    lastUse[program.output] = instructions.size();
+
+    std::vector<unsigned> physical(program.registerCount, Unused);
+    std::vector<unsigned> free;
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        Instruction &instruction = instructions[i];
+        unsigned sources = SourceCount(instruction.op);
+
+        unsigned virt[2] = { instruction.src[0], instruction.src[1] };
+        for (unsigned j = 0; j < sources; j++) {
+            instruction.src[j] = physical[virt[j]];
+        }
+
+        // Instructions are element-wise, so the destination may reuse a source that dies here
+        for (unsigned j = 0; j < sources; j++) {
+            if (lastUse[virt[j]] == i && physical[virt[j]] != Unused) {
+                free.push_back(physical[virt[j]]);
+                physical[virt[j]] = Unused;
+            }
+        }
+
+        unsigned dst = instruction.dst;
+        if (free.empty()) {
+            free.push_back(count++);
+        }
+        physical[dst] = free.back();
+        free.pop_back();
+        instruction.dst = physical[dst];
+
+        if (lastUse[dst] == Unused) {
+            free.push_back(physical[dst]);
+            physical[dst] = Unused;
+        }
+    }
+
+    program.output = physical[program.output];
+    program.registerCount = count;
+}
+
+// Points the reads a masked range makes of registers written before it at copies of their own,
+// allocated past the others, which can be packed without disturbing the originals. Nested ranges copy
+// the copies of their outer ones.
+void NodeCompiler::CopyMaskedInputs()
+{
+    for (NodeProgram::MaskedRange &range : program.masked) {
+        std::vector<bool> written(program.registerCount, false);
+        for (unsigned i = range.begin; i < range.end; i++) {
+            Instruction &instruction = program.instructions[i];
+            for (unsigned j = 0; j < SourceCount(instruction.op); j++) {
+                unsigned r = instruction.src[j];
+                if (r < written.size() && written[r]) {
+                    continue;
+                }
+                auto it = std::find(range.inputs.begin(), range.inputs.end(), r);
+                if (it == range.inputs.end()) {
+                    range.inputs.push_back(r);
+                    range.copies.push_back(program.registerCount++);
+                    it = range.inputs.end() - 1;
+                }
+                instruction.src[j] = range.copies[it - range.inputs.begin()];
+            }
+            written[instruction.dst] = true;
+        }
+    }
+}
+
+unsigned NodeCompiler::ZeroRegister()
+{
+    if (zeroRegister < 0) {
+        zeroRegister = Emit(Instruction(Opcode::Constant));
+    }
+    return zeroRegister;
+}
\ No newline at end of file
@@ -0,0 +1,459 @@
+#include "NodeProgram.h"
+#include "Node.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+
+// Layout shared with the generated source below
+struct NativeHost
+{
+    const void *program;
+    void (*perlin)(const void *program, unsigned resource, const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, const void *grid);
+    void (*generate)(const void *program, unsigned instruction, const float *x, const float *y, const float *z, float *out, unsigned count, float spacing, const void *grid);
+};
+
+typedef void (*NativeRun)(const NativeHost *host, const float *x, const float *y, const float *z, float *registers, unsigned count, float spacing, const void *grid);
+
+static const char *NativePrelude =
+    "// Generated from a node program by NodeProgram::CompileNative\n"
+    "#include <cmath>\n"
+    "\n"
+    "struct Host\n"
+    "{\n"
+    "    const void *program;\n"
+    "    void (*perlin)(const void *program, unsigned resource, const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, const void *grid);\n"
+    "    void (*generate)(const void *program, unsigned instruction, const float *x, const float *y, const float *z, float *out, unsigned count, float spacing, const void *grid);\n"
+    "};\n"
+    "\n"
+    "static inline float clamp(float v) { return (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v; }\n"
+    "\n"
+    "extern \"C\" void RunBlock(const Host *host, const float *x0, const float *y0, const float *z0, float *r, unsigned n0, float spacing, const void *g0)\n"
+    "{\n";
+
+static const char *NativeFlags[] = { "-std=c++11", "-O3", "-ffp-contract=off", "-fPIC", "-shared" };
+
+struct NodeProgram::NativeKernel
+{
+    NativeKernel(void *handle, NativeRun run) : handle(handle), run(run) { };
+    ~NativeKernel() { dlclose(handle); };
+
+    void *handle;
+    NativeRun run;
+};
+
+void NodeProgram::RunNative(const float *x, const float *y, const float *z, float *registers, unsigned count, float spacing, const GridRows *grid) const
+{
+    NativeHost host = { this, NativePerlin, NativeGenerate };
+    native->run(&host, x, y, z, registers, count, spacing, grid);
+}
+
+void NodeProgram::NativePerlin(const void *program, unsigned resource, const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, const void *grid)
+{
+    const noise::PerlinNoise &noise = ((const NodeProgram *)program)->perlin[resource];
+    const GridRows *rows = (const GridRows *)grid;
+    if (rows) {
+        noise.SampleGrid(rows->x, rows->width, rows->y, rows->height, rows->z, out, octaves, frequency, persistence, lacunarity, spacing);
+    } else if (z) {
+        noise.Sample(x, y, z, out, count, octaves, frequency, persistence, lacunarity, spacing);
+    } else {
+        noise.Sample2D(x, y, out, count, octaves, frequency, persistence, lacunarity, spacing);
+    }
+}
+
+void NodeProgram::NativeGenerate(const void *program, unsigned instruction, const float *x, const float *y, const float *z, float *out, unsigned count, float spacing, const void *grid)
+{
+    const NodeProgram *self = (const NodeProgram *)program;
+    self->Generate(self->instructions[instruction], x, y, z, out, count, spacing, (const GridRows *)grid);
+}
+
+// Float literal reading back to exactly v, empty for infinities and NaNs
+static std::string Literal(float v)
+{
+    if (!std::isfinite(v)) {
+        return std::string();
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", v);
+    std::string literal = buffer;
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return literal + "f";
+}
+
+// Writes the body of the generated RunBlock. The lanes of masked ranges nested d deep are counted by
+// nd, with coordinates xd, yd, zd and grid gd.
+class NativeWriter
+{
+    public:
+        NativeWriter(const std::vector<Instruction> &instructions, const std::vector<NodeProgram::MaskedRange> &masked, unsigned blockSize) : instructions(instructions), masked(masked), blockSize(blockSize), nesting(1), locals(0), valid(true) { };
+
+        void Range(unsigned begin, unsigned end, unsigned range, unsigned depth);
+        std::string Source() const { return valid ? out.str() : std::string(); };
+
+    private:
+        // Arithmetic waiting to be written as one loop, with the register each statement sets
+        struct Statement
+        {
+            unsigned dst;
+            Instruction instruction;
+            bool style;     // The style of the Perlin generator at dst rather than the instruction
+        };
+
+        unsigned Masked(unsigned range, unsigned depth);
+        void Flush(unsigned depth);
+        std::string Expression(const Statement &statement, const std::string &a, const std::string &b);
+        std::string Register(unsigned r, const char *i = "i") const;
+        std::string Indent() const { return std::string(4 * nesting, ' '); };
+        std::string Number(float v);
+
+        const std::vector<Instruction> &instructions;
+        const std::vector<NodeProgram::MaskedRange> &masked;
+        unsigned blockSize;
+        std::vector<Statement> pending;
+        std::ostringstream out;
+        unsigned nesting;
+        unsigned locals;
+        bool valid;
+};
+
+std::string NativeWriter::Number(float v)
+{
+    std::string literal = Literal(v);
+    valid &= !literal.empty();
+    return literal;
+}
+
+std::string NativeWriter::Register(unsigned r, const char *i) const
+{
+    std::ostringstream s;
+    s << "r[" << r * blockSize << " + " << i << "]";
+    return s.str();
+}
+
+// Same arithmetic as the interpreter, so both give the same bits
+std::string NativeWriter::Expression(const Statement &statement, const std::string &a, const std::string &b)
+{
+    const Instruction &instruction = statement.instruction;
+    const float *params = instruction.params;
+
+    if (statement.style) {
+        std::string v = "((" + a + " + 1.0f) / 2.0f)";
+        if (instruction.style == Perlin::Billowy) {
+            return "fabs(" + v + " - 0.5f) + 0.5f";
+        } else if (instruction.style == Perlin::Ridged) {
+            return "0.5f - fabs(" + v + " - 0.5f)";
+        }
+        return v;
+    }
+
+    switch (instruction.op) {
+        case Opcode::Constant:
+            return Number(params[0]);
+        case Opcode::Abs:
+            return "fabs(" + a + " + -0.5f) + 0.5f";
+        case Opcode::Invert:
+            return "1.0f - " + a;
+        case Opcode::Selector: {
+            std::string min = Number(params[0]), max = Number(params[1]);
+            std::string fuzz = Number((params[1] - params[0]) * (1.0f - params[2]));
+            return a + " < " + min + " ? (" + min + " - " + a + " <= " + fuzz + " ? 1.0f - (" + min + " - " + a + ") / " + fuzz + " : 0.0f) : " +
+                   a + " > " + max + " ? (" + a + " - " + max + " <= " + fuzz + " ? 1.0f - (" + a + " - " + max + ") / " + fuzz + " : 0.0f) : 1.0f";
+        }
+        case Opcode::Add:
+            return "clamp(" + a + " + " + b + " * " + Number(params[0]) + ")";
+        case Opcode::Multiply:
+            return "clamp(" + a + " * (" + b + " * " + Number(params[0]) + "))";
+        default:
+            valid = false;
+            return std::string();
+    }
+}
+
+// One loop over the lanes for all the pending statements. Values stay in locals between them and
+// only the last value of each register is stored.
+void NativeWriter::Flush(unsigned depth)
+{
+    if (pending.empty()) {
+        return;
+    }
+    std::string indent = Indent();
+    out << indent << "for (unsigned i = 0; i < n" << depth << "; i++) {\n";
+
+    std::unordered_map<unsigned, std::string> value;
+    std::vector<unsigned> written;
+    for (const Statement &statement : pending) {
+        std::string sources[2];
+        unsigned count = statement.style ? 1 : statement.instruction.op == Opcode::Add || statement.instruction.op == Opcode::Multiply ? 2 : statement.instruction.op == Opcode::Constant ? 0 : 1;
+        for (unsigned j = 0; j < count; j++) {
+            unsigned r = statement.style ? statement.dst : statement.instruction.src[j];
+            if (!value.count(r)) {
+                value[r] = "v" + std::to_string(locals++);
+                out << indent << "    const float " << value[r] << " = " << Register(r) << ";\n";
+            }
+            sources[j] = value[r];
+        }
+
+        std::string local = "v" + std::to_string(locals++);
+        out << indent << "    const float " << local << " = " << Expression(statement, sources[0], sources[1]) << ";\n";
+        if (std::find(written.begin(), written.end(), statement.dst) == written.end()) {
+            written.push_back(statement.dst);
+        }
+        value[statement.dst] = local;
+    }
+    for (unsigned r : written) {
+        out << indent << "    " << Register(r) << " = " << value[r] << ";\n";
+    }
+    out << indent << "}\n";
+    pending.clear();
+}
+
+void NativeWriter::Range(unsigned begin, unsigned end, unsigned range, unsigned depth)
+{
+    std::string indent = Indent();
+    std::string d = std::to_string(depth);
+
+    for (unsigned k = begin; k < end;) {
+        if (range < masked.size() && masked[range].begin == k) {
+            Flush(depth);
+            k = masked[range].end;
+            range = Masked(range, depth);
+            continue;
+        }
+
+        const Instruction &instruction = instructions[k];
+        switch (instruction.op) {
+            case Opcode::Perlin:
+                Flush(depth);
+                if (instruction.style == Perlin::Classic || instruction.style == Perlin::Billowy || instruction.style == Perlin::Ridged) {
+                    out << indent << "host->perlin(host->program, " << instruction.resource << ", x" << d << ", y" << d << ", z" << d << ", r + " << instruction.dst * blockSize << ", n" << d << ", " <<
+                           instruction.octaves << ", " << Number(instruction.params[0]) << ", " << Number(instruction.params[1]) << ", " << Number(instruction.params[2]) << ", spacing, g" << d << ");\n";
+                    pending.push_back({ instruction.dst, instruction, true });
+                    break;
+                }
+                // Styles it does not know come back styled
+                out << indent << "host->generate(host->program, " << k << ", x" << d << ", y" << d << ", z" << d << ", r + " << instruction.dst * blockSize << ", n" << d << ", spacing, g" << d << ");\n";
+                break;
+            case Opcode::Simplex:
+            case Opcode::Spectral:
+            case Opcode::Voronoi:
+            case Opcode::JitteredVoronoi:
+                Flush(depth);
+                out << indent << "host->generate(host->program, " << k << ", x" << d << ", y" << d << ", z" << d << ", r + " << instruction.dst * blockSize << ", n" << d << ", spacing, nullptr);\n";
+                break;
+            case Opcode::Slope:
+                valid = false;
+                break;
+            default:
+                pending.push_back({ instruction.dst, instruction, false });
+                break;
+        }
+        k++;
+    }
+    Flush(depth);
+}
+
+// Mirrors NodeProgram::RunMasked, returning the next range outside this one
+unsigned NativeWriter::Masked(unsigned range, unsigned depth)
+{
+    const NodeProgram::MaskedRange &current = masked[range];
+    const Instruction &multiply = instructions[current.end];
+    unsigned mask = multiply.src[current.mask], result = multiply.src[1 - current.mask];
+
+    unsigned next = range + 1;
+    while (next < masked.size() && masked[next].begin < current.end) {
+        next++;
+    }
+
+    std::string indent = Indent();
+    std::string d = std::to_string(depth), e = std::to_string(depth + 1);
+    out << indent << "{\n";
+    out << indent << "    unsigned lanes" << e << "[" << blockSize << "], n" << e << " = 0;\n";
+    out << indent << "    for (unsigned i = 0; i < n" << d << "; i++) {\n";
+    out << indent << "        if (" << Register(mask) << " != 0.0f) {\n";
+    out << indent << "            lanes" << e << "[n" << e << "++] = i;\n";
+    out << indent << "        }\n";
+    out << indent << "    }\n";
+    out << indent << "    if (n" << e << " == 0) {\n";
+    out << indent << "        for (unsigned i = 0; i < n" << d << "; i++) {\n";
+    out << indent << "            " << Register(result) << " = 0.0f;\n";
+    out << indent << "        }\n";
+    out << indent << "    } else {\n";
+    for (unsigned j = 0; j < current.inputs.size(); j++) {
+        out << indent << "        for (unsigned i = 0; i < n" << e << "; i++) {\n";
+        out << indent << "            " << Register(current.copies[j]) << " = " << Register(current.inputs[j], ("lanes" + e + "[i]").c_str()) << ";\n";
+        out << indent << "        }\n";
+    }
+    out << indent << "        const float *x" << e << " = x" << d << ", *y" << e << " = y" << d << ", *z" << e << " = z" << d << ";\n";
+    out << indent << "        const void *g" << e << " = g" << d << ";\n";
+    out << indent << "        float xs" << e << "[" << blockSize << "], ys" << e << "[" << blockSize << "], zs" << e << "[" << blockSize << "];\n";
+    out << indent << "        if (n" << e << " != n" << d << ") {\n";
+    out << indent << "            for (unsigned i = 0; i < n" << e << "; i++) {\n";
+    out << indent << "                xs" << e << "[i] = x" << d << "[lanes" << e << "[i]];\n";
+    out << indent << "                ys" << e << "[i] = y" << d << "[lanes" << e << "[i]];\n";
+    out << indent << "                zs" << e << "[i] = z" << d << " ? z" << d << "[lanes" << e << "[i]] : 0.0f;\n";
+    out << indent << "            }\n";
+    out << indent << "            x" << e << " = xs" << e << ";\n";
+    out << indent << "            y" << e << " = ys" << e << ";\n";
+    out << indent << "            z" << e << " = z" << d << " ? zs" << e << " : nullptr;\n";
+    out << indent << "            g" << e << " = nullptr;\n";
+    out << indent << "        }\n";
+    nesting += 2;
+    Range(current.begin, current.end, range + 1, depth + 1);
+    nesting -= 2;
+    out << indent << "        if (n" << e << " != n" << d << ") {\n";
+    out << indent << "            for (unsigned i = n" << d << ", k = n" << e << "; i-- > 0;) {\n";
+    out << indent << "                " << Register(result) << " = k > 0 && lanes" << e << "[k - 1] == i ? " << Register(result, "--k") << " : 0.0f;\n";
+    out << indent << "            }\n";
+    out << indent << "        }\n";
+    out << indent << "    }\n";
+    out << indent << "}\n";
+    return next;
+}
+
+std::string NodeProgram::NativeSource() const
+{
+    NativeWriter writer(instructions, masked, BlockSize);
+    writer.Range(0, instructions.size(), 0, 0);
+    std::string body = writer.Source();
+    return body.empty() && !instructions.empty() ? std::string() : NativePrelude + body + "}\n";
+}
+
+// FNV-1a, stable from one run to the next
+static uint64_t SourceHash(const std::string &source)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// $XDG_CACHE_HOME/terrain/kernels or ~/.cache/terrain/kernels, created on demand
+static std::string CacheDirectory()
+{
+    std::string path;
+    if (const char *cache = getenv("XDG_CACHE_HOME")) {
+        path = cache;
+    } else if (const char *home = getenv("HOME")) {
+        path = std::string(home) + "/.cache";
+    } else {
+        return std::string();
+    }
+    path += "/terrain/kernels";
+
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode) ? path : std::string();
+}
+
+// Runs a command without a shell, so paths need no quoting, with its output discarded
+static bool Execute(const std::vector<std::string> &arguments)
+{
+    std::vector<char *> argv;
+    for (const std::string &argument : arguments) {
+        argv.push_back(const_cast<char *>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool NodeProgram::CompileNative()
+{
+    if (gradients) {
+        return false;
+    }
+    std::string source = NativeSource();
+    std::string directory = CacheDirectory();
+    if (source.empty() || directory.empty()) {
+        return false;
+    }
+
+    // $CXX may carry options of its own, like a launcher in front of the compiler
+    std::vector<std::string> command;
+    const char *cxx = getenv("CXX");
+    std::istringstream words(cxx && *cxx ? cxx : "c++");
+    for (std::string word; words >> word;) {
+        command.push_back(word);
+    }
+    if (command.empty()) {
+        command.push_back("c++");
+    }
+    command.insert(command.end(), std::begin(NativeFlags), std::end(NativeFlags));
+
+    std::string signature;
+    for (const std::string &argument : command) {
+        signature += argument + " ";
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)SourceHash(signature + "\n" + source));
+    std::string library = directory + "/" + name + ".so";
+
+    void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        // Built under a name of its own and renamed into place, so that no other thread or process
+        // ever loads a library half written
+        static std::atomic<unsigned> builds(0);
+        std::string unique = "." + std::to_string(getpid()) + "." + std::to_string(builds++);
+        std::string file = directory + "/" + name + unique + ".cpp";
+        std::string temporary = library + unique;
+
+        std::ofstream(file) << source;
+        command.insert(command.end(), { "-o", temporary, file });
+        bool built = Execute(command) && rename(temporary.c_str(), library.c_str()) == 0;
+        remove(file.c_str());
+        if (!built) {
+            remove(temporary.c_str());
+            return false;
+        }
+        handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            return false;
+        }
+    }
+
+    NativeRun run = (NativeRun)dlsym(handle, "RunBlock");
+    if (!run) {
+        dlclose(handle);
+        return false;
+    }
+    native = std::make_shared<const NativeKernel>(handle, run);
+    return true;
+}
\ No newline at end of file
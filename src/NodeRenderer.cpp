@@ -1,16 +1,79 @@
 #include "NodeRenderer.h"
+#include "NodeProgram.h"
+#include <algorithm>
+
+const unsigned NodeRenderer::TileSize;
 
 const NodeRenderer::ImageData &NodeRenderer::Render(const Node *node)
 {
-    image.clear();
+    return Render(NodeCompiler::Compile(node));
+}
+
+const NodeRenderer::ImageData &NodeRenderer::Render(const NodeProgram &program)
+{
+    image.resize(imageSize * imageSize * 3);
 
-    for (unsigned i = 0; i < imageSize; i++) {
-        for(unsigned j = 0; j < imageSize; j++) {
-            float v = node->Evaluate((float)j / imageSize, (float)i / imageSize, 0.0f);
-            unsigned char b = v * 255;
-            image.insert(image.end(), { b, b, b });
+    // Every pixel is computed independently, so the image is the same whatever the thread count
+    unsigned tiles = (imageSize + TileSize - 1) / TileSize;
+    pool.Run(tiles * tiles, [&](unsigned tile) {
+        if (!cancel || !*cancel) {
+            RenderTile(program, tile % tiles, tile / tiles);
         }
-    }
+    });
 
     return image;
+}
+
+void NodeRenderer::RenderTile(const NodeProgram &program, unsigned tileX, unsigned tileY)
+{
+    unsigned x0 = tileX * TileSize, x1 = std::min(x0 + TileSize, imageSize);
+    unsigned y0 = tileY * TileSize, y1 = std::min(y0 + TileSize, imageSize);
+    unsigned width = x1 - x0;
+    unsigned height = y1 - y0;
+
+    float spacing = limitOctaves ? 1.0f / imageSize : 0.0f;
+
+    // Tiles the bounds of the program pin to one value are filled without evaluating it
+    float min, max;
+    program.Range((float)x0 / imageSize, (float)y0 / imageSize, (float)(x1 - 1) / imageSize, (float)(y1 - 1) / imageSize, 0.0f, &min, &max, spacing);
+    if (min == max) {
+        unsigned char b = min * 255;
+        for (unsigned i = y0; i < y1; i++) {
+            std::fill(&image[(i * imageSize + x0) * 3], &image[(i * imageSize + x1) * 3], b);
+        }
+        return;
+    }
+
+    if (fixedPoint) {
+        std::vector<uint8_t> grey(width * height);
+        if (program.RunGridFixed((float)x0 / imageSize, 1.0f / imageSize, width, (float)y0 / imageSize, 1.0f / imageSize, height, grey.data(), spacing)) {
+            for (unsigned i = y0, k = 0; i < y1; i++) {
+                unsigned char *row = &image[(i * imageSize + x0) * 3];
+                for (unsigned j = 0; j < width; j++, k++) {
+                    row[j * 3] = row[j * 3 + 1] = row[j * 3 + 2] = grey[k];
+                }
+            }
+            return;
+        }
+    }
+
+    std::vector<float> xs(width), ys(height);
+    std::vector<float> values(width * height);
+
+    for (unsigned j = x0; j < x1; j++) {
+        xs[j - x0] = (float)j / imageSize;
+    }
+    for (unsigned i = y0; i < y1; i++) {
+        ys[i - y0] = (float)i / imageSize;
+    }
+
+    program.RunGrid(xs.data(), width, ys.data(), height, 0.0f, values.data(), spacing);
+
+    for (unsigned i = y0, k = 0; i < y1; i++) {
+        unsigned char *row = &image[(i * imageSize + x0) * 3];
+        for (unsigned j = 0; j < width; j++, k++) {
+            unsigned char b = values[k] * 255;
+            row[j * 3] = row[j * 3 + 1] = row[j * 3 + 2] = b;
+        }
+    }
 }
\ No newline at end of file
@@ -1,13 +1,21 @@
 #include "PerlinNoise.h"
+#include "NoiseKernels.h"
+#include "Simd.h"
 #include <cassert>
 #include <random>
 #include <algorithm>
+#include <vector>
 #include <cmath>
+#include <limits>
 
 using namespace noise;
 
 unsigned PerlinNoise::Hash(unsigned x, unsigned y, unsigned z) const
 {
+    if (hashed) {
+        return kernels::LatticeHash(x, y, z, latticeSeed);
+    }
+
     unsigned a = permutation[x & 255] + y;
     unsigned b = permutation[a & 255] + z;
     return permutation[b & 255];
@@ -36,17 +44,29 @@ float PerlinNoise::Grad(unsigned x, unsigned y, unsigned z, float dx, float dy,
     }
 }
 
+// Gradient vectors behind Grad, indexed by the hash
+static const float gradX[16] = { 1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0,  1,  0, -1,  0 };
+static const float gradY[16] = { 1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1,  1, -1,  1, -1 };
+static const float gradZ[16] = { 0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1,  0,  1,  0, -1 };
+
 float Ease(float p)
 {
     return p * p * p * (p * (p * 6  - 15) + 10);
 }
 
+// Derivative of Ease
+static float EaseSlope(float p)
+{
+    float q = p * (p - 1);
+    return 30 * q * q;
+}
+
 float Lerp(float t, float a, float b)
 {
     return a + t * (b - a);
 }
 
-PerlinNoise::PerlinNoise(uint64_t seed)
+PerlinNoise::PerlinNoise(uint64_t seed) : hashed(false)
 {
     for (unsigned i = 0; i < 256; i++) {
         permutation[i] = i;
@@ -59,9 +79,9 @@ float PerlinNoise::Sample(float x, float y, float z) const
 {
     assert(x >= 0 && y >= 0);
 
-    unsigned xGrid = (unsigned)x & 255,
-             yGrid = (unsigned)y & 255,
-             zGrid = (unsigned)z & 255;
+    unsigned xGrid = (unsigned)x,
+             yGrid = (unsigned)y,
+             zGrid = (unsigned)z;
     float xRel = x - floor(x),
           yRel = y - floor(y),
           zRel = z - floor(z);
@@ -95,9 +115,596 @@ float PerlinNoise::Sample(float x, float y, float z, unsigned octaves, float fre
     return sum / max;
 }
 
+float PerlinNoise::Sample2D(float x, float y) const
+{
+    assert(x >= 0 && y >= 0);
+
+    unsigned xGrid = (unsigned)x,
+             yGrid = (unsigned)y;
+    float xRel = x - floor(x),
+          yRel = y - floor(y);
+    float u = Ease(xRel),
+          v = Ease(yRel);
+
+    return Lerp(v, Lerp(u, Grad(xGrid    , yGrid    , 0, xRel    , yRel    , 0),
+                           Grad(xGrid + 1, yGrid    , 0, xRel - 1, yRel    , 0)),
+                   Lerp(u, Grad(xGrid    , yGrid + 1, 0, xRel    , yRel - 1, 0),
+                           Grad(xGrid + 1, yGrid + 1, 0, xRel - 1, yRel - 1, 0)));
+}
+
+float PerlinNoise::Sample2D(float x, float y, unsigned octaves, float frequency, float persistence, float lacunarity) const
+{
+    float sum = 0;
+    float amplitude = 1;
+    float max = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        sum += Sample2D(x * frequency, y * frequency) * amplitude;
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    return sum / max;
+}
+
+// The noise blends the corner values n with eased weights, so its slope along x is the blend of the
+// x components of the corner gradients plus the slope of the weights times the differences of n along x.
+// Kernels evaluate the same expressions in the same order.
+float PerlinNoise::SampleGradient(float x, float y, float z, float *gradient) const
+{
+    assert(x >= 0 && y >= 0);
+
+    unsigned xGrid = (unsigned)x,
+             yGrid = (unsigned)y,
+             zGrid = (unsigned)z;
+    float xRel = x - floor(x),
+          yRel = y - floor(y),
+          zRel = z - floor(z);
+    float u = Ease(xRel),
+          v = Ease(yRel),
+          w = Ease(zRel);
+
+    // Corners are numbered by their x, y and z offsets in bits 0, 1 and 2
+    float n[8], gx[8], gy[8], gz[8];
+    for (unsigned c = 0; c < 8; c++) {
+        unsigned cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+        unsigned h = Hash(xGrid + cx, yGrid + cy, zGrid + cz) & 15;
+        gx[c] = gradX[h];
+        gy[c] = gradY[h];
+        gz[c] = gradZ[h];
+        n[c] = gx[c] * (xRel - cx) + gy[c] * (yRel - cy) + gz[c] * (zRel - cz);
+    }
+
+    gradient[0] = EaseSlope(xRel) * Lerp(w, Lerp(v, n[1] - n[0], n[3] - n[2]), Lerp(v, n[5] - n[4], n[7] - n[6]))
+                + Lerp(w, Lerp(v, Lerp(u, gx[0], gx[1]), Lerp(u, gx[2], gx[3])), Lerp(v, Lerp(u, gx[4], gx[5]), Lerp(u, gx[6], gx[7])));
+    gradient[1] = EaseSlope(yRel) * Lerp(w, Lerp(u, n[2] - n[0], n[3] - n[1]), Lerp(u, n[6] - n[4], n[7] - n[5]))
+                + Lerp(w, Lerp(v, Lerp(u, gy[0], gy[1]), Lerp(u, gy[2], gy[3])), Lerp(v, Lerp(u, gy[4], gy[5]), Lerp(u, gy[6], gy[7])));
+    gradient[2] = EaseSlope(zRel) * Lerp(v, Lerp(u, n[4] - n[0], n[5] - n[1]), Lerp(u, n[6] - n[2], n[7] - n[3]))
+                + Lerp(w, Lerp(v, Lerp(u, gz[0], gz[1]), Lerp(u, gz[2], gz[3])), Lerp(v, Lerp(u, gz[4], gz[5]), Lerp(u, gz[6], gz[7])));
+
+    return Lerp(w, Lerp(v, Lerp(u, n[0], n[1]), Lerp(u, n[2], n[3])),
+                   Lerp(v, Lerp(u, n[4], n[5]), Lerp(u, n[6], n[7])));
+}
+
+float PerlinNoise::SampleGradient(float x, float y, float z, float *gradient, unsigned octaves, float frequency, float persistence, float lacunarity) const
+{
+    float sum = 0;
+    float amplitude = 1;
+    float max = 0;
+    gradient[0] = gradient[1] = gradient[2] = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        float g[3];
+        sum += SampleGradient(x * frequency, y * frequency, z * frequency, g) * amplitude;
+        for (unsigned j = 0; j < 3; j++) {
+            gradient[j] += g[j] * (amplitude * frequency);
+        }
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    for (unsigned j = 0; j < 3; j++) {
+        gradient[j] /= max;
+    }
+    return sum / max;
+}
+
+void PerlinNoise::SampleGradient(const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+#ifdef NOISE_X86_KERNELS
+    kernels::Lattice lattice = { hashed ? nullptr : permutation, latticeSeed };
+    kernels::FractalParams params = { octaves, frequency, persistence, lacunarity, spacing };
+    switch (ActiveSimdLevel()) {
+        case SimdLevel::AVX512: kernels::PerlinGradientAVX512(lattice, params, x, y, z, out, dx, dy, count); return;
+        case SimdLevel::AVX2: kernels::PerlinGradientAVX2(lattice, params, x, y, z, out, dx, dy, count); return;
+        default: break;
+    }
+#endif
+
+    std::fill(out, out + count, 0.0f);
+    std::fill(dx, dx + count, 0.0f);
+    std::fill(dy, dy + count, 0.0f);
+
+    float amplitude = 1;
+    float max = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        float weight = kernels::OctaveWeight(frequency, spacing);
+        if (weight > 0) {
+            float scale = amplitude * weight;
+            for (unsigned j = 0; j < count; j++) {
+                float g[3];
+                out[j] += SampleGradient(x[j] * frequency, y[j] * frequency, z ? z[j] * frequency : 0.0f, g) * scale;
+                dx[j] += g[0] * (scale * frequency);
+                dy[j] += g[1] * (scale * frequency);
+            }
+        }
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    for (unsigned j = 0; j < count; j++) {
+        out[j] /= max;
+        dx[j] /= max;
+        dy[j] /= max;
+    }
+}
+
+void PerlinNoise::Sample(const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    SampleBlock(x, y, z, out, count, octaves, frequency, persistence, lacunarity, spacing);
+}
+
+void PerlinNoise::Sample2D(const float *x, const float *y, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    SampleBlock(x, y, nullptr, out, count, octaves, frequency, persistence, lacunarity, spacing);
+}
+
+void PerlinNoise::SampleBlock(const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing, unsigned first) const
+{
+#ifdef NOISE_X86_KERNELS
+    kernels::Lattice lattice = { hashed ? nullptr : permutation, latticeSeed };
+    kernels::FractalParams params = { octaves, frequency, persistence, lacunarity, spacing, first };
+    switch (ActiveSimdLevel()) {
+        case SimdLevel::AVX512: kernels::PerlinAVX512(lattice, params, x, y, z, out, count); return;
+        case SimdLevel::AVX2: kernels::PerlinAVX2(lattice, params, x, y, z, out, count); return;
+        case SimdLevel::SSE2: kernels::PerlinSSE2(lattice, params, x, y, z, out, count); return;
+        default: break;
+    }
+#endif
+
+    if (first == 0) {
+        std::fill(out, out + count, 0.0f);
+    }
+
+    float amplitude = 1;
+    float max = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        float weight = i < first ? 0.0f : kernels::OctaveWeight(frequency, spacing);
+        if (weight > 0 && z) {
+            for (unsigned j = 0; j < count; j++) {
+                out[j] += Sample(x[j] * frequency, y[j] * frequency, z[j] * frequency) * (amplitude * weight);
+            }
+        } else if (weight > 0) {
+            for (unsigned j = 0; j < count; j++) {
+                out[j] += Sample2D(x[j] * frequency, y[j] * frequency) * (amplitude * weight);
+            }
+        }
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    for (unsigned j = 0; j < count; j++) {
+        out[j] /= max;
+    }
+}
+
+// Fewer samples per cell than this and hashing the corners per sample on the block kernels is faster
+static const float minSpan = 8;
+
+void PerlinNoise::SampleGrid(const float *x, unsigned width, const float *y, unsigned height, float z, float *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    unsigned count = width * height;
+    if (count == 0) {
+        return;
+    }
+    std::fill(out, out + count, 0.0f);
+
+    // Leading octaves coarse enough go span by span along each row
+    std::vector<float> xs(width);
+    unsigned spanned = 0;
+    float f = frequency;
+    float amplitude = 1;
+    for (; spanned < octaves; spanned++) {
+        for (unsigned i = 0; i < width; i++) {
+            xs[i] = x[i] * f;
+        }
+        if (width < (fabs(xs[width - 1] - xs[0]) + 1) * minSpan) {
+            break;
+        }
+
+        float weight = kernels::OctaveWeight(f, spacing);
+        if (weight > 0) {
+            for (unsigned j = 0; j < height; j++) {
+                SampleRow(xs.data(), width, y[j] * f, z * f, out + j * width, amplitude * weight);
+            }
+        }
+
+        f *= lacunarity;
+        amplitude *= persistence;
+    }
+
+    // The block path picks up the partial sums for the remaining octaves and normalizes
+    std::vector<float> ys(width), zs(width, z);
+    for (unsigned j = 0; j < height; j++) {
+        std::fill(ys.begin(), ys.end(), y[j]);
+        SampleBlock(x, ys.data(), z == 0.0f ? nullptr : zs.data(), out + j * width, width, octaves, frequency, persistence, lacunarity, spacing, spanned);
+    }
+}
+
+void PerlinNoise::SampleGrid(float x0, float y0, float z, float dx, float dy, unsigned width, unsigned height, float *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    std::vector<float> xs(width), ys(height);
+    for (unsigned i = 0; i < width; i++) {
+        xs[i] = x0 + i * dx;
+    }
+    for (unsigned j = 0; j < height; j++) {
+        ys[j] = y0 + j * dy;
+    }
+    SampleGrid(xs.data(), width, ys.data(), height, z, out, octaves, frequency, persistence, lacunarity, spacing);
+}
+
+// Same expressions as Sample, with the y and z parts of the corner dot products taken from the span
+static void SampleSpan(const kernels::GridSpan &span, const float *x, float *out, unsigned count, float scale)
+{
+    for (unsigned i = 0; i < count; i++) {
+        float xRel = x[i] - floor(x[i]);
+        float u = Ease(xRel);
+        float n[8];
+        for (unsigned c = 0; c < (span.planar ? 4u : 8u); c++) {
+            n[c] = span.gx[c] * (xRel - (c & 1)) + span.ty[c] + span.tz[c];
+        }
+
+        float value = Lerp(span.v, Lerp(u, n[0], n[1]), Lerp(u, n[2], n[3]));
+        if (!span.planar) {
+            value = Lerp(span.w, value, Lerp(span.v, Lerp(u, n[4], n[5]), Lerp(u, n[6], n[7])));
+        }
+        out[i] += value * scale;
+    }
+}
+
+void PerlinNoise::SampleRow(const float *x, unsigned width, float y, float z, float *out, float scale) const
+{
+    assert(y >= 0);
+
+    unsigned yGrid = (unsigned)y,
+             zGrid = (unsigned)z;
+    float yRel = y - floor(y),
+          zRel = z - floor(z);
+
+    kernels::GridSpan span;
+    span.v = Ease(yRel);
+    span.w = Ease(zRel);
+    span.planar = z == 0.0f;
+
+    for (unsigned begin = 0, end; begin < width; begin = end) {
+        unsigned xGrid = (unsigned)x[begin];
+        for (end = begin + 1; end < width && (unsigned)x[end] == xGrid; end++);
+
+        for (unsigned c = 0; c < (span.planar ? 4u : 8u); c++) {
+            unsigned cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+            unsigned h = Hash(xGrid + cx, yGrid + cy, zGrid + cz) & 15;
+            span.gx[c] = gradX[h];
+            span.ty[c] = gradY[h] * (yRel - cy);
+            span.tz[c] = gradZ[h] * (zRel - cz);
+        }
+
+#ifdef NOISE_X86_KERNELS
+        switch (ActiveSimdLevel()) {
+            case SimdLevel::AVX512: kernels::PerlinSpanAVX512(span, x + begin, out + begin, end - begin, scale); continue;
+            case SimdLevel::AVX2: kernels::PerlinSpanAVX2(span, x + begin, out + begin, end - begin, scale); continue;
+            case SimdLevel::SSE2: kernels::PerlinSpanSSE2(span, x + begin, out + begin, end - begin, scale); continue;
+            default: break;
+        }
+#endif
+        SampleSpan(span, x + begin, out + begin, end - begin, scale);
+    }
+}
+
+// Q16 fraction to the eased weight in Q15, rounded as in the kernels, see PerlinNoiseSIMD.cpp
+static inline int16_t EaseFixed(uint16_t t)
+{
+    uint16_t c = 61440 - ((t * 24576u) >> 16);
+    uint16_t b = 40960 - ((t * (unsigned)c) >> 16);
+    uint16_t t3 = (((t * (unsigned)t) >> 16) * t) >> 16;
+    return (int16_t)std::min((t3 * (unsigned)b) >> 13, 32767u);
+}
+
+static inline int16_t MulFixed(int16_t a, int16_t b)
+{
+    return (int16_t)((a * b + 0x4000) >> 15);
+}
+
+static inline int16_t LerpFixed(int16_t t, int16_t a, int16_t b)
+{
+    return (int16_t)(a + MulFixed(t, (int16_t)(b - a)));
+}
+
+static void SampleSpanFixed(const kernels::FixedSpan &span, const uint16_t *x, int16_t *out, unsigned count, int16_t scale)
+{
+    for (unsigned i = 0; i < count; i++) {
+        int16_t u = EaseFixed(x[i]);
+        int xRel = x[i] >> 3;
+        int16_t n[4];
+        for (unsigned c = 0; c < 4; c++) {
+            n[c] = (int16_t)(span.gx[c] * (xRel - (int)(c & 1) * 8192) + span.ty[c]);
+        }
+
+        int16_t value = LerpFixed(span.v, LerpFixed(u, n[0], n[1]), LerpFixed(u, n[2], n[3]));
+        int sum = out[i] + MulFixed(value, scale);
+        out[i] = (int16_t)std::min(std::max(sum, -32768), 32767);
+    }
+}
+
+void PerlinNoise::SampleRowFixed(const unsigned *cell, const uint16_t *fraction, unsigned width, uint64_t y, int16_t *out, int16_t scale) const
+{
+    unsigned yGrid = (unsigned)(y >> 16);
+    uint16_t yRel = (uint16_t)y;
+
+    kernels::FixedSpan span;
+    span.v = EaseFixed(yRel);
+
+    for (unsigned begin = 0, end; begin < width; begin = end) {
+        unsigned xGrid = cell[begin];
+        for (end = begin + 1; end < width && cell[end] == xGrid; end++);
+
+        for (unsigned c = 0; c < 4; c++) {
+            unsigned cx = c & 1, cy = c >> 1;
+            unsigned h = Hash(xGrid + cx, yGrid + cy, 0) & 15;
+            span.gx[c] = (int16_t)gradX[h];
+            span.ty[c] = (int16_t)(gradY[h] * ((yRel >> 3) - (int)cy * 8192));
+        }
+
+        // A span too short to fill a vector is cheaper on the scalar path
+#ifdef NOISE_X86_KERNELS
+        if (end - begin >= 8) {
+            switch (ActiveSimdLevel()) {
+                case SimdLevel::AVX512:
+                case SimdLevel::AVX2: kernels::PerlinSpanFixedAVX2(span, fraction + begin, out + begin, end - begin, scale); continue;
+                case SimdLevel::SSE2: kernels::PerlinSpanFixedSSE2(span, fraction + begin, out + begin, end - begin, scale); continue;
+                default: break;
+            }
+        }
+#endif
+        SampleSpanFixed(span, fraction + begin, out + begin, end - begin, scale);
+    }
+}
+
+void PerlinNoise::SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, int16_t *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    assert(x0 >= 0 && y0 >= 0);
+
+    unsigned count = width * height;
+    if (count == 0) {
+        return;
+    }
+    std::fill(out, out + count, 0);
+
+    float max = 0;
+    float amplitude = 1;
+    for (unsigned i = 0; i < octaves; i++) {
+        max += amplitude;
+        amplitude *= persistence;
+    }
+
+    // As in SampleGrid, the leading octaves coarse enough go span by span
+    std::vector<unsigned> cells(width);
+    std::vector<uint16_t> fractions(width);
+    unsigned spanned = 0;
+    double f = frequency;
+    amplitude = 1;
+    for (; spanned < octaves; spanned++) {
+        for (unsigned i = 0; i < width; i++) {
+            uint64_t x = (uint64_t)llround((x0 + (double)i * dx) * f * 65536);
+            cells[i] = (unsigned)(x >> 16);
+            fractions[i] = (uint16_t)x;
+        }
+        if (width < (cells[width - 1] - cells[0] + 1) * minSpan) {
+            break;
+        }
+
+        long scale = lround(amplitude * kernels::OctaveWeight((float)f, spacing) / max * 32768);
+        if (scale > 0) {
+            for (unsigned j = 0; j < height; j++) {
+                uint64_t y = (uint64_t)llround((y0 + (double)j * dy) * f * 65536);
+                SampleRowFixed(cells.data(), fractions.data(), width, y, out + j * width, (int16_t)std::min(scale, 32767L));
+            }
+        }
+
+        f *= lacunarity;
+        amplitude *= persistence;
+    }
+    if (spanned == octaves) {
+        return;
+    }
+
+    // Hashing the corners dominates the finer ones, where the float block kernels are faster
+    std::vector<float> xs(width), ys(width), values(width);
+    for (unsigned i = 0; i < width; i++) {
+        xs[i] = x0 + i * dx;
+    }
+    for (unsigned j = 0; j < height; j++) {
+        std::fill(ys.begin(), ys.end(), y0 + j * dy);
+        std::fill(values.begin(), values.end(), 0.0f);
+        SampleBlock(xs.data(), ys.data(), nullptr, values.data(), width, octaves, frequency, persistence, lacunarity, spacing, spanned);
+        for (unsigned i = 0; i < width; i++) {
+            int sum = out[j * width + i] + (int)lrintf(values[i] * 8192);
+            out[j * width + i] = (int16_t)std::min(std::max(sum, -32768), 32767);
+        }
+    }
+}
+
+void PerlinNoise::SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, uint8_t *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    std::vector<int16_t> sums(width * height);
+    SampleGridFixed(x0, y0, dx, dy, width, height, sums.data(), octaves, frequency, persistence, lacunarity, spacing);
+    for (unsigned i = 0; i < width * height; i++) {
+        int v = std::min(std::max((int)sums[i], -8192), 8192) + 8192;
+        out[i] = (uint8_t)((v * 255 + 8192) >> 14);
+    }
+}
+
+void PerlinNoise::SampleGridFixed(float x0, float y0, float dx, float dy, unsigned width, unsigned height, uint16_t *out, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    std::vector<int16_t> sums(width * height);
+    SampleGridFixed(x0, y0, dx, dy, width, height, sums.data(), octaves, frequency, persistence, lacunarity, spacing);
+    for (unsigned i = 0; i < width * height; i++) {
+        int v = std::min(std::max((int)sums[i], -8192), 8192) + 8192;
+        out[i] = (uint16_t)((v * 65535 + 8192) >> 14);
+    }
+}
+
+// Lerp is multilinear in t, a and b, so over intervals of them it peaks at their ends
+static void LerpRange(float t0, float t1, const float *a, const float *b, float *out)
+{
+    out[0] = out[1] = Lerp(t0, a[0], b[0]);
+    for (float t : { t0, t1 }) {
+        for (unsigned i = 0; i < 2; i++) {
+            for (unsigned j = 0; j < 2; j++) {
+                float v = Lerp(t, a[i], b[j]);
+                out[0] = std::min(out[0], v);
+                out[1] = std::max(out[1], v);
+            }
+        }
+    }
+}
+
+// A rectangle covering more cells than this is bounded by the extremes of the noise instead
+static const unsigned maxRangeCells = 64;
+// Pieces each cell is split into along x and y when the rectangle lies within few of them
+static const unsigned rangePieces = 4;
+
+void PerlinNoise::OctaveRange(float x0, float y0, float x1, float y1, float z, float *min, float *max) const
+{
+    // The corner dot products stay within 2, and the lerps between them too
+    unsigned xCells = (unsigned)x1 - (unsigned)x0 + 1, yCells = (unsigned)y1 - (unsigned)y0 + 1;
+    if (xCells * yCells > maxRangeCells) {
+        *min = -2.0f;
+        *max = 2.0f;
+        return;
+    }
+
+    bool planar = z == 0.0f;
+    unsigned zGrid = (unsigned)z;
+    float zRel = z - floor(z);
+    float w = Ease(zRel);
+    unsigned pieces = xCells * yCells > 4 ? 1 : rangePieces;
+
+    *min = std::numeric_limits<float>::max();
+    *max = -std::numeric_limits<float>::max();
+    for (unsigned yGrid = (unsigned)y0; yGrid <= (unsigned)y1; yGrid++) {
+        for (unsigned xGrid = (unsigned)x0; xGrid <= (unsigned)x1; xGrid++) {
+            // Part of the rectangle within the cell, relative to its corner
+            float left = std::max(x0 - xGrid, 0.0f), right = std::min(x1 - xGrid, 1.0f);
+            float top = std::max(y0 - yGrid, 0.0f), bottom = std::min(y1 - yGrid, 1.0f);
+
+            unsigned h[8];
+            for (unsigned c = 0; c < (planar ? 4u : 8u); c++) {
+                h[c] = Hash(xGrid + (c & 1), yGrid + ((c >> 1) & 1), zGrid + (c >> 2)) & 15;
+            }
+
+            for (unsigned j = 0; j < pieces; j++) {
+                float b0 = top + (bottom - top) * j / pieces, b1 = top + (bottom - top) * (j + 1) / pieces;
+                for (unsigned i = 0; i < pieces; i++) {
+                    float a0 = left + (right - left) * i / pieces, a1 = left + (right - left) * (i + 1) / pieces;
+
+                    // The dot products are linear, their extremes lie on the corners of the piece
+                    float n[8][2];
+                    for (unsigned c = 0; c < (planar ? 4u : 8u); c++) {
+                        float cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+                        float xs[2] = { gradX[h[c]] * (a0 - cx), gradX[h[c]] * (a1 - cx) };
+                        float ys[2] = { gradY[h[c]] * (b0 - cy), gradY[h[c]] * (b1 - cy) };
+                        float zs = planar ? 0.0f : gradZ[h[c]] * (zRel - cz);
+                        n[c][0] = std::min(xs[0], xs[1]) + std::min(ys[0], ys[1]) + zs;
+                        n[c][1] = std::max(xs[0], xs[1]) + std::max(ys[0], ys[1]) + zs;
+                    }
+
+                    // Ease is monotonic
+                    float u0 = Ease(a0), u1 = Ease(a1), v0 = Ease(b0), v1 = Ease(b1);
+                    float front[2], back[2], edges[2][2], value[2];
+                    LerpRange(u0, u1, n[0], n[1], edges[0]);
+                    LerpRange(u0, u1, n[2], n[3], edges[1]);
+                    LerpRange(v0, v1, edges[0], edges[1], front);
+                    if (planar) {
+                        value[0] = front[0];
+                        value[1] = front[1];
+                    } else {
+                        LerpRange(u0, u1, n[4], n[5], edges[0]);
+                        LerpRange(u0, u1, n[6], n[7], edges[1]);
+                        LerpRange(v0, v1, edges[0], edges[1], back);
+                        LerpRange(w, w, front, back, value);
+                    }
+                    *min = std::min(*min, value[0]);
+                    *max = std::max(*max, value[1]);
+                }
+            }
+        }
+    }
+}
+
+void PerlinNoise::Range(float x0, float y0, float x1, float y1, float z, float *min, float *max, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+    // The samplers only cover x, y >= 0, rectangles reaching below get the bound of any value
+    bool outside = !(x0 >= 0 && y0 >= 0);
+
+    float amplitude = 1;
+    float total = 0;
+    float lo = 0, hi = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        float weight = kernels::OctaveWeight(frequency, spacing);
+        if (weight > 0) {
+            float a = -2.0f, b = 2.0f;
+            if (!outside) {
+                OctaveRange(x0 * frequency, y0 * frequency, x1 * frequency, y1 * frequency, z * frequency, &a, &b);
+            }
+            // Rounding of the samples themselves
+            lo += (a - 1e-5f) * (amplitude * weight);
+            hi += (b + 1e-5f) * (amplitude * weight);
+        }
+        total += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    *min = lo / total;
+    *max = hi / total;
+}
+
 void PerlinNoise::Seed(uint64_t seed)
 {
     std::mt19937_64 prng(seed);
 
     std::shuffle(permutation, permutation + 256, prng);
+    latticeSeed = prng();
+}
+
+bool PerlinNoise::HashedLattice() const
+{
+    return hashed;
+}
+
+void PerlinNoise::HashedLattice(bool hashed)
+{
+    this->hashed = hashed;
+}
+
+bool PerlinNoise::operator==(const PerlinNoise &other) const
+{
+    return std::equal(permutation, permutation + 256, other.permutation) && latticeSeed == other.latticeSeed &&
+           hashed == other.hashed;
 }
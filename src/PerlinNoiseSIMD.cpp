@@ -0,0 +1,1051 @@
+#include "NoiseKernels.h"
+
+#ifdef NOISE_X86_KERNELS
+
+#include <immintrin.h>
+#include <algorithm>
+
+using namespace noise::kernels;
+
+// Coefficients of (dx, dy, dz) for every hash value, the same gradients PerlinNoise::Grad switches over.
+// A zero coefficient can only change the sign of a zero result, so kernels agree with the scalar path
+// on every value, down to the bit, apart from +0 and -0.
+alignas(64) static const float gradX[16] = { 1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0,  1,  0, -1,  0 };
+alignas(64) static const float gradY[16] = { 1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1,  1, -1,  1, -1 };
+alignas(64) static const float gradZ[16] = { 0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1,  0,  1,  0, -1 };
+
+// Corner hashes share their first lookups: Hash(x, y + 1, z) = p[p[p[x] + y + 1] + z] and so on, which
+// brings the lookups per sample down from 24 to 14. Kernels follow the scalar expression order exactly.
+
+// SSE2, 4 lanes. SSE2 has no gathers, so the table lookups are done per lane.
+
+__attribute__((target("sse2")))
+static inline __m128 FloorSSE2(__m128 v)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 EaseSSE2(__m128 p)
+{
+    __m128 inner = _mm_add_ps(_mm_mul_ps(p, _mm_sub_ps(_mm_mul_ps(p, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(p, p), p), inner);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 LerpSSE2(__m128 t, __m128 a, __m128 b)
+{
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 GradSSE2(const unsigned *hash, __m128 dx, __m128 dy, __m128 dz)
+{
+    __m128 gx = _mm_setr_ps(gradX[hash[0] & 15], gradX[hash[1] & 15], gradX[hash[2] & 15], gradX[hash[3] & 15]);
+    __m128 gy = _mm_setr_ps(gradY[hash[0] & 15], gradY[hash[1] & 15], gradY[hash[2] & 15], gradY[hash[3] & 15]);
+    __m128 gz = _mm_setr_ps(gradZ[hash[0] & 15], gradZ[hash[1] & 15], gradZ[hash[2] & 15], gradZ[hash[3] & 15]);
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, dx), _mm_mul_ps(gy, dy)), _mm_mul_ps(gz, dz));
+}
+
+// SSE2 only multiplies the even lanes, so the odd ones go through a second multiply
+__attribute__((target("sse2")))
+static inline __m128i MulLoSSE2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Integer lattice hashes of the first count corners, ordered x, then y, then z
+__attribute__((target("sse2")))
+static void LatticeCornersSSE2(unsigned seed, __m128i X, __m128i Y, __m128i Z, unsigned (*h)[4], unsigned count)
+{
+    __m128i one = _mm_set1_epi32(1);
+    __m128i hx[2] = { MulLoSSE2(X, _mm_set1_epi32(latticeX)), MulLoSSE2(_mm_add_epi32(X, one), _mm_set1_epi32(latticeX)) };
+    __m128i hy[2] = { MulLoSSE2(Y, _mm_set1_epi32(latticeY)), MulLoSSE2(_mm_add_epi32(Y, one), _mm_set1_epi32(latticeY)) };
+    __m128i hz[2] = { MulLoSSE2(Z, _mm_set1_epi32(latticeZ)), MulLoSSE2(_mm_add_epi32(Z, one), _mm_set1_epi32(latticeZ)) };
+
+    for (unsigned c = 0; c < count; c++) {
+        __m128i v = _mm_xor_si128(_mm_xor_si128(_mm_set1_epi32(seed), hx[c & 1]), _mm_xor_si128(hy[c >> 1 & 1], hz[c >> 2]));
+        v = _mm_xor_si128(v, _mm_srli_epi32(v, 16));
+        v = MulLoSSE2(v, _mm_set1_epi32(latticeMix1));
+        v = _mm_xor_si128(v, _mm_srli_epi32(v, 15));
+        v = MulLoSSE2(v, _mm_set1_epi32(latticeMix2));
+        v = _mm_xor_si128(v, _mm_srli_epi32(v, 16));
+        _mm_storeu_si128((__m128i *)h[c], v);
+    }
+}
+
+__attribute__((target("sse2")))
+static __m128 SampleSSE2(const Lattice &lattice, __m128 x, __m128 y, __m128 z)
+{
+    const unsigned *p = lattice.permutation;
+
+    alignas(16) unsigned xi[4], yi[4], zi[4];
+    _mm_store_si128((__m128i *)xi, _mm_cvttps_epi32(x));
+    _mm_store_si128((__m128i *)yi, _mm_cvttps_epi32(y));
+    _mm_store_si128((__m128i *)zi, _mm_cvttps_epi32(z));
+
+    unsigned h[8][4];
+    if (!p) {
+        LatticeCornersSSE2(lattice.seed, _mm_cvttps_epi32(x), _mm_cvttps_epi32(y), _mm_cvttps_epi32(z), h, 8);
+    }
+    for (unsigned l = 0; p && l < 4; l++) {
+        unsigned X = xi[l] & 255, Y = yi[l] & 255, Z = zi[l] & 255;
+        unsigned A = p[X] + Y, B = p[(X + 1) & 255] + Y;
+        unsigned AA = p[A & 255] + Z, AB = p[(A + 1) & 255] + Z;
+        unsigned BA = p[B & 255] + Z, BB = p[(B + 1) & 255] + Z;
+        h[0][l] = p[AA & 255];
+        h[1][l] = p[BA & 255];
+        h[2][l] = p[AB & 255];
+        h[3][l] = p[BB & 255];
+        h[4][l] = p[(AA + 1) & 255];
+        h[5][l] = p[(BA + 1) & 255];
+        h[6][l] = p[(AB + 1) & 255];
+        h[7][l] = p[(BB + 1) & 255];
+    }
+
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 xr = _mm_sub_ps(x, FloorSSE2(x)), yr = _mm_sub_ps(y, FloorSSE2(y)), zr = _mm_sub_ps(z, FloorSSE2(z));
+    __m128 xr1 = _mm_sub_ps(xr, one), yr1 = _mm_sub_ps(yr, one), zr1 = _mm_sub_ps(zr, one);
+    __m128 u = EaseSSE2(xr), v = EaseSSE2(yr), w = EaseSSE2(zr);
+
+    return LerpSSE2(w, LerpSSE2(v, LerpSSE2(u, GradSSE2(h[0], xr, yr, zr), GradSSE2(h[1], xr1, yr, zr)),
+                                   LerpSSE2(u, GradSSE2(h[2], xr, yr1, zr), GradSSE2(h[3], xr1, yr1, zr))),
+                       LerpSSE2(v, LerpSSE2(u, GradSSE2(h[4], xr, yr, zr1), GradSSE2(h[5], xr1, yr, zr1)),
+                                   LerpSSE2(u, GradSSE2(h[6], xr, yr1, zr1), GradSSE2(h[7], xr1, yr1, zr1))));
+}
+
+__attribute__((target("sse2")))
+static __m128 Sample2DSSE2(const Lattice &lattice, __m128 x, __m128 y)
+{
+    const unsigned *p = lattice.permutation;
+
+    alignas(16) unsigned xi[4], yi[4];
+    _mm_store_si128((__m128i *)xi, _mm_cvttps_epi32(x));
+    _mm_store_si128((__m128i *)yi, _mm_cvttps_epi32(y));
+
+    unsigned h[4][4];
+    if (!p) {
+        LatticeCornersSSE2(lattice.seed, _mm_cvttps_epi32(x), _mm_cvttps_epi32(y), _mm_setzero_si128(), h, 4);
+    }
+    for (unsigned l = 0; p && l < 4; l++) {
+        unsigned X = xi[l] & 255, Y = yi[l] & 255;
+        unsigned A = p[X] + Y, B = p[(X + 1) & 255] + Y;
+        h[0][l] = p[p[A & 255] & 255];
+        h[1][l] = p[p[B & 255] & 255];
+        h[2][l] = p[p[(A + 1) & 255] & 255];
+        h[3][l] = p[p[(B + 1) & 255] & 255];
+    }
+
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+    __m128 xr = _mm_sub_ps(x, FloorSSE2(x)), yr = _mm_sub_ps(y, FloorSSE2(y));
+    __m128 xr1 = _mm_sub_ps(xr, one), yr1 = _mm_sub_ps(yr, one);
+    __m128 u = EaseSSE2(xr), v = EaseSSE2(yr);
+
+    return LerpSSE2(v, LerpSSE2(u, GradSSE2(h[0], xr, yr, zero), GradSSE2(h[1], xr1, yr, zero)),
+                       LerpSSE2(u, GradSSE2(h[2], xr, yr1, zero), GradSSE2(h[3], xr1, yr1, zero)));
+}
+
+__attribute__((target("sse2")))
+static __m128 FractalSSE2(const Lattice &lattice, const FractalParams &params, __m128 x, __m128 y, __m128 z, __m128 sum, bool planar)
+{
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (i >= params.first && weight > 0) {
+            __m128 f = _mm_set1_ps(frequency);
+            __m128 sample = planar ? Sample2DSSE2(lattice, _mm_mul_ps(x, f), _mm_mul_ps(y, f))
+                                   : SampleSSE2(lattice, _mm_mul_ps(x, f), _mm_mul_ps(y, f), _mm_mul_ps(z, f));
+            sum = _mm_add_ps(sum, _mm_mul_ps(sample, _mm_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm_div_ps(sum, _mm_set1_ps(max));
+}
+
+__attribute__((target("sse2")))
+void noise::kernels::PerlinSSE2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    bool planar = !z;
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 zi = planar ? _mm_setzero_ps() : _mm_loadu_ps(z + i);
+        __m128 sum = params.first ? _mm_loadu_ps(out + i) : _mm_setzero_ps();
+        _mm_storeu_ps(out + i, FractalSSE2(lattice, params, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), zi, sum, planar));
+    }
+    if (i < count) {
+        alignas(16) float tail[4][4] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (!planar) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        if (params.first) {
+            std::copy(out + i, out + count, tail[3]);
+        }
+        _mm_store_ps(tail[3], FractalSSE2(lattice, params, _mm_load_ps(tail[0]), _mm_load_ps(tail[1]), _mm_load_ps(tail[2]), _mm_load_ps(tail[3]), planar));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+__attribute__((target("sse2")))
+static inline __m128 SpanCornerSSE2(const GridSpan &span, unsigned c, __m128 dx)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(span.gx[c]), dx), _mm_set1_ps(span.ty[c])), _mm_set1_ps(span.tz[c]));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 SpanSSE2(const GridSpan &span, __m128 x)
+{
+    __m128 xr = _mm_sub_ps(x, FloorSSE2(x)), xr1 = _mm_sub_ps(xr, _mm_set1_ps(1.0f));
+    __m128 u = EaseSSE2(xr), v = _mm_set1_ps(span.v);
+
+    __m128 front = LerpSSE2(v, LerpSSE2(u, SpanCornerSSE2(span, 0, xr), SpanCornerSSE2(span, 1, xr1)),
+                               LerpSSE2(u, SpanCornerSSE2(span, 2, xr), SpanCornerSSE2(span, 3, xr1)));
+    if (span.planar) {
+        return front;
+    }
+    __m128 back = LerpSSE2(v, LerpSSE2(u, SpanCornerSSE2(span, 4, xr), SpanCornerSSE2(span, 5, xr1)),
+                              LerpSSE2(u, SpanCornerSSE2(span, 6, xr), SpanCornerSSE2(span, 7, xr1)));
+    return LerpSSE2(_mm_set1_ps(span.w), front, back);
+}
+
+__attribute__((target("sse2")))
+void noise::kernels::PerlinSpanSSE2(const GridSpan &span, const float *x, float *out, unsigned count, float scale)
+{
+    __m128 s = _mm_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(SpanSSE2(span, _mm_loadu_ps(x + i)), s)));
+    }
+    if (i < count) {
+        alignas(16) float tail[2][4] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(out + i, out + count, tail[1]);
+        _mm_store_ps(tail[1], _mm_add_ps(_mm_load_ps(tail[1]), _mm_mul_ps(SpanSSE2(span, _mm_load_ps(tail[0])), s)));
+        std::copy(tail[1], tail[1] + count - i, out + i);
+    }
+}
+
+// Fixed point. The fade is evaluated on unsigned Q16 as t^3 * (10 - 15t + 6t^2), with the second
+// factor scaled by 1/16 to fit, and clamped below one in Q15 since its rounding errors can carry it
+// over near t = 1. Products of signed values round like mulhrs.
+
+__attribute__((target("sse2")))
+static inline __m128i FadeFixedSSE2(__m128i t)
+{
+    __m128i c = _mm_sub_epi16(_mm_set1_epi16((short)61440), _mm_mulhi_epu16(t, _mm_set1_epi16(24576)));
+    __m128i b = _mm_sub_epi16(_mm_set1_epi16((short)40960), _mm_mulhi_epu16(t, c));
+    __m128i t3 = _mm_mulhi_epu16(_mm_mulhi_epu16(t, t), t);
+    __m128i fade = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epu16(t3, b), 3), _mm_srli_epi16(_mm_mullo_epi16(t3, b), 13));
+    return _mm_sub_epi16(fade, _mm_subs_epu16(fade, _mm_set1_epi16(32767)));
+}
+
+// SSE2 has no mulhrs, the rounding bit comes from the low half of the product
+__attribute__((target("sse2")))
+static inline __m128i MulRoundSSE2(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_mullo_epi16(a, b);
+    __m128i r = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(a, b), 1), _mm_srli_epi16(lo, 15));
+    return _mm_add_epi16(r, _mm_and_si128(_mm_srli_epi16(lo, 14), _mm_set1_epi16(1)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i LerpFixedSSE2(__m128i t, __m128i a, __m128i b)
+{
+    return _mm_add_epi16(a, MulRoundSSE2(t, _mm_sub_epi16(b, a)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i SpanFixedSSE2(const FixedSpan &span, __m128i x)
+{
+    __m128i u = FadeFixedSSE2(x);
+    __m128i xr = _mm_srli_epi16(x, 3), xr1 = _mm_sub_epi16(xr, _mm_set1_epi16(8192));
+    __m128i n0 = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.gx[0]), xr), _mm_set1_epi16(span.ty[0]));
+    __m128i n1 = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.gx[1]), xr1), _mm_set1_epi16(span.ty[1]));
+    __m128i n2 = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.gx[2]), xr), _mm_set1_epi16(span.ty[2]));
+    __m128i n3 = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.gx[3]), xr1), _mm_set1_epi16(span.ty[3]));
+    return LerpFixedSSE2(_mm_set1_epi16(span.v), LerpFixedSSE2(u, n0, n1), LerpFixedSSE2(u, n2, n3));
+}
+
+__attribute__((target("sse2")))
+void noise::kernels::PerlinSpanFixedSSE2(const FixedSpan &span, const uint16_t *x, int16_t *out, unsigned count, int16_t scale)
+{
+    __m128i s = _mm_set1_epi16(scale);
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i sum = _mm_loadu_si128((const __m128i *)(out + i));
+        __m128i value = SpanFixedSSE2(span, _mm_loadu_si128((const __m128i *)(x + i)));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_adds_epi16(sum, MulRoundSSE2(value, s)));
+    }
+    if (i < count) {
+        alignas(16) uint16_t tailX[8] = {};
+        alignas(16) int16_t tailOut[8] = {};
+        std::copy(x + i, x + count, tailX);
+        std::copy(out + i, out + count, tailOut);
+        __m128i value = SpanFixedSSE2(span, _mm_load_si128((const __m128i *)tailX));
+        _mm_store_si128((__m128i *)tailOut, _mm_adds_epi16(_mm_load_si128((const __m128i *)tailOut), MulRoundSSE2(value, s)));
+        std::copy(tailOut, tailOut + count - i, out + i);
+    }
+}
+
+// AVX2, 8 lanes, table hashes with gathers and gradients with in-register table permutes
+
+__attribute__((target("avx2")))
+static inline __m256 EaseAVX2(__m256 p)
+{
+    __m256 inner = _mm256_add_ps(_mm256_mul_ps(p, _mm256_sub_ps(_mm256_mul_ps(p, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(p, p), p), inner);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 EaseSlopeAVX2(__m256 p)
+{
+    __m256 q = _mm256_mul_ps(p, _mm256_sub_ps(p, _mm256_set1_ps(1)));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30), q), q);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 LerpAVX2(__m256 t, __m256 a, __m256 b)
+{
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i LookupAVX2(const unsigned *p, __m256i i)
+{
+    return _mm256_i32gather_epi32((const int *)p, _mm256_and_si256(i, _mm256_set1_epi32(255)), 4);
+}
+
+__attribute__((target("avx2")))
+static inline void GradVectorAVX2(__m256i hash, __m256 &gx, __m256 &gy, __m256 &gz)
+{
+    // permutevar only looks at the low three bits, bit 3 selects the upper half of each table
+    __m256 upper = _mm256_castsi256_ps(_mm256_slli_epi32(hash, 28));
+    gx = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradX), hash), _mm256_permutevar8x32_ps(_mm256_load_ps(gradX + 8), hash), upper);
+    gy = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradY), hash), _mm256_permutevar8x32_ps(_mm256_load_ps(gradY + 8), hash), upper);
+    gz = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradZ), hash), _mm256_permutevar8x32_ps(_mm256_load_ps(gradZ + 8), hash), upper);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 GradAVX2(__m256i hash, __m256 dx, __m256 dy, __m256 dz)
+{
+    __m256 gx, gy, gz;
+    GradVectorAVX2(hash, gx, gy, gz);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy)), _mm256_mul_ps(gz, dz));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i LatticeHashAVX2(__m256i hx, __m256i hy, __m256i hz, __m256i seed)
+{
+    __m256i h = _mm256_xor_si256(_mm256_xor_si256(seed, hx), _mm256_xor_si256(hy, hz));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(latticeMix1));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(latticeMix2));
+    return _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+}
+
+// Hashes of the cell corners in the order x, then y, then z: h[1] is x + 1, h[2] is y + 1 and so on.
+// The 2D variant only fills the four corners of the z = 0 face.
+__attribute__((target("avx2")))
+static inline void CornersAVX2(const Lattice &lattice, __m256i X, __m256i Y, __m256i Z, __m256i *h, bool planar)
+{
+    const unsigned *p = lattice.permutation;
+    __m256i one = _mm256_set1_epi32(1);
+
+    if (!p) {
+        // The per-axis products are shared between corners
+        __m256i hx[2] = { _mm256_mullo_epi32(X, _mm256_set1_epi32(latticeX)), _mm256_mullo_epi32(_mm256_add_epi32(X, one), _mm256_set1_epi32(latticeX)) };
+        __m256i hy[2] = { _mm256_mullo_epi32(Y, _mm256_set1_epi32(latticeY)), _mm256_mullo_epi32(_mm256_add_epi32(Y, one), _mm256_set1_epi32(latticeY)) };
+        __m256i hz[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        if (!planar) {
+            hz[0] = _mm256_mullo_epi32(Z, _mm256_set1_epi32(latticeZ));
+            hz[1] = _mm256_mullo_epi32(_mm256_add_epi32(Z, one), _mm256_set1_epi32(latticeZ));
+        }
+        __m256i seed = _mm256_set1_epi32(lattice.seed);
+        for (unsigned c = 0; c < (planar ? 4u : 8u); c++) {
+            h[c] = LatticeHashAVX2(hx[c & 1], hy[c >> 1 & 1], hz[c >> 2], seed);
+        }
+        return;
+    }
+
+    __m256i A = _mm256_add_epi32(LookupAVX2(p, X), Y);
+    __m256i B = _mm256_add_epi32(LookupAVX2(p, _mm256_add_epi32(X, one)), Y);
+    if (planar) {
+        h[0] = LookupAVX2(p, LookupAVX2(p, A));
+        h[1] = LookupAVX2(p, LookupAVX2(p, B));
+        h[2] = LookupAVX2(p, LookupAVX2(p, _mm256_add_epi32(A, one)));
+        h[3] = LookupAVX2(p, LookupAVX2(p, _mm256_add_epi32(B, one)));
+        return;
+    }
+    __m256i AA = _mm256_add_epi32(LookupAVX2(p, A), Z);
+    __m256i AB = _mm256_add_epi32(LookupAVX2(p, _mm256_add_epi32(A, one)), Z);
+    __m256i BA = _mm256_add_epi32(LookupAVX2(p, B), Z);
+    __m256i BB = _mm256_add_epi32(LookupAVX2(p, _mm256_add_epi32(B, one)), Z);
+    h[0] = LookupAVX2(p, AA);
+    h[1] = LookupAVX2(p, BA);
+    h[2] = LookupAVX2(p, AB);
+    h[3] = LookupAVX2(p, BB);
+    h[4] = LookupAVX2(p, _mm256_add_epi32(AA, one));
+    h[5] = LookupAVX2(p, _mm256_add_epi32(BA, one));
+    h[6] = LookupAVX2(p, _mm256_add_epi32(AB, one));
+    h[7] = LookupAVX2(p, _mm256_add_epi32(BB, one));
+}
+
+__attribute__((target("avx2")))
+static __m256 SampleAVX2(const Lattice &lattice, __m256 x, __m256 y, __m256 z)
+{
+    __m256i h[8];
+    CornersAVX2(lattice, _mm256_cvttps_epi32(x), _mm256_cvttps_epi32(y), _mm256_cvttps_epi32(z), h, false);
+
+    __m256 fone = _mm256_set1_ps(1.0f);
+    __m256 xr = _mm256_sub_ps(x, _mm256_floor_ps(x)), yr = _mm256_sub_ps(y, _mm256_floor_ps(y)), zr = _mm256_sub_ps(z, _mm256_floor_ps(z));
+    __m256 xr1 = _mm256_sub_ps(xr, fone), yr1 = _mm256_sub_ps(yr, fone), zr1 = _mm256_sub_ps(zr, fone);
+    __m256 u = EaseAVX2(xr), v = EaseAVX2(yr), w = EaseAVX2(zr);
+
+    return LerpAVX2(w, LerpAVX2(v, LerpAVX2(u, GradAVX2(h[0], xr, yr, zr), GradAVX2(h[1], xr1, yr, zr)),
+                                   LerpAVX2(u, GradAVX2(h[2], xr, yr1, zr), GradAVX2(h[3], xr1, yr1, zr))),
+                       LerpAVX2(v, LerpAVX2(u, GradAVX2(h[4], xr, yr, zr1), GradAVX2(h[5], xr1, yr, zr1)),
+                                   LerpAVX2(u, GradAVX2(h[6], xr, yr1, zr1), GradAVX2(h[7], xr1, yr1, zr1))));
+}
+
+__attribute__((target("avx2")))
+static __m256 Sample2DAVX2(const Lattice &lattice, __m256 x, __m256 y)
+{
+    __m256i h[4];
+    CornersAVX2(lattice, _mm256_cvttps_epi32(x), _mm256_cvttps_epi32(y), _mm256_setzero_si256(), h, true);
+
+    __m256 fone = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    __m256 xr = _mm256_sub_ps(x, _mm256_floor_ps(x)), yr = _mm256_sub_ps(y, _mm256_floor_ps(y));
+    __m256 xr1 = _mm256_sub_ps(xr, fone), yr1 = _mm256_sub_ps(yr, fone);
+    __m256 u = EaseAVX2(xr), v = EaseAVX2(yr);
+
+    return LerpAVX2(v, LerpAVX2(u, GradAVX2(h[0], xr, yr, zero), GradAVX2(h[1], xr1, yr, zero)),
+                       LerpAVX2(u, GradAVX2(h[2], xr, yr1, zero), GradAVX2(h[3], xr1, yr1, zero)));
+}
+
+__attribute__((target("avx2")))
+static __m256 FractalAVX2(const Lattice &lattice, const FractalParams &params, __m256 x, __m256 y, __m256 z, __m256 sum, bool planar)
+{
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (i >= params.first && weight > 0) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 sample = planar ? Sample2DAVX2(lattice, _mm256_mul_ps(x, f), _mm256_mul_ps(y, f))
+                                   : SampleAVX2(lattice, _mm256_mul_ps(x, f), _mm256_mul_ps(y, f), _mm256_mul_ps(z, f));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(sample, _mm256_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm256_div_ps(sum, _mm256_set1_ps(max));
+}
+
+__attribute__((target("avx2")))
+void noise::kernels::PerlinAVX2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    bool planar = !z;
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 zi = planar ? _mm256_setzero_ps() : _mm256_loadu_ps(z + i);
+        __m256 sum = params.first ? _mm256_loadu_ps(out + i) : _mm256_setzero_ps();
+        _mm256_storeu_ps(out + i, FractalAVX2(lattice, params, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), zi, sum, planar));
+    }
+    if (i < count) {
+        alignas(32) float tail[4][8] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (!planar) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        if (params.first) {
+            std::copy(out + i, out + count, tail[3]);
+        }
+        _mm256_store_ps(tail[3], FractalAVX2(lattice, params, _mm256_load_ps(tail[0]), _mm256_load_ps(tail[1]), _mm256_load_ps(tail[2]), _mm256_load_ps(tail[3]), planar));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256 SpanCornerAVX2(const GridSpan &span, unsigned c, __m256 dx)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(span.gx[c]), dx), _mm256_set1_ps(span.ty[c])), _mm256_set1_ps(span.tz[c]));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 SpanAVX2(const GridSpan &span, __m256 x)
+{
+    __m256 xr = _mm256_sub_ps(x, _mm256_floor_ps(x)), xr1 = _mm256_sub_ps(xr, _mm256_set1_ps(1.0f));
+    __m256 u = EaseAVX2(xr), v = _mm256_set1_ps(span.v);
+
+    __m256 front = LerpAVX2(v, LerpAVX2(u, SpanCornerAVX2(span, 0, xr), SpanCornerAVX2(span, 1, xr1)),
+                               LerpAVX2(u, SpanCornerAVX2(span, 2, xr), SpanCornerAVX2(span, 3, xr1)));
+    if (span.planar) {
+        return front;
+    }
+    __m256 back = LerpAVX2(v, LerpAVX2(u, SpanCornerAVX2(span, 4, xr), SpanCornerAVX2(span, 5, xr1)),
+                              LerpAVX2(u, SpanCornerAVX2(span, 6, xr), SpanCornerAVX2(span, 7, xr1)));
+    return LerpAVX2(_mm256_set1_ps(span.w), front, back);
+}
+
+__attribute__((target("avx2")))
+void noise::kernels::PerlinSpanAVX2(const GridSpan &span, const float *x, float *out, unsigned count, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(SpanAVX2(span, _mm256_loadu_ps(x + i)), s)));
+    }
+    if (i < count) {
+        alignas(32) float tail[2][8] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(out + i, out + count, tail[1]);
+        _mm256_store_ps(tail[1], _mm256_add_ps(_mm256_load_ps(tail[1]), _mm256_mul_ps(SpanAVX2(span, _mm256_load_ps(tail[0])), s)));
+        std::copy(tail[1], tail[1] + count - i, out + i);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i FadeFixedAVX2(__m256i t)
+{
+    __m256i c = _mm256_sub_epi16(_mm256_set1_epi16((short)61440), _mm256_mulhi_epu16(t, _mm256_set1_epi16(24576)));
+    __m256i b = _mm256_sub_epi16(_mm256_set1_epi16((short)40960), _mm256_mulhi_epu16(t, c));
+    __m256i t3 = _mm256_mulhi_epu16(_mm256_mulhi_epu16(t, t), t);
+    __m256i fade = _mm256_or_si256(_mm256_slli_epi16(_mm256_mulhi_epu16(t3, b), 3), _mm256_srli_epi16(_mm256_mullo_epi16(t3, b), 13));
+    return _mm256_min_epu16(fade, _mm256_set1_epi16(32767));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i LerpFixedAVX2(__m256i t, __m256i a, __m256i b)
+{
+    return _mm256_add_epi16(a, _mm256_mulhrs_epi16(t, _mm256_sub_epi16(b, a)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i SpanFixedAVX2(const FixedSpan &span, __m256i x)
+{
+    __m256i u = FadeFixedAVX2(x);
+    __m256i xr = _mm256_srli_epi16(x, 3), xr1 = _mm256_sub_epi16(xr, _mm256_set1_epi16(8192));
+    __m256i n0 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_set1_epi16(span.gx[0]), xr), _mm256_set1_epi16(span.ty[0]));
+    __m256i n1 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_set1_epi16(span.gx[1]), xr1), _mm256_set1_epi16(span.ty[1]));
+    __m256i n2 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_set1_epi16(span.gx[2]), xr), _mm256_set1_epi16(span.ty[2]));
+    __m256i n3 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_set1_epi16(span.gx[3]), xr1), _mm256_set1_epi16(span.ty[3]));
+    return LerpFixedAVX2(_mm256_set1_epi16(span.v), LerpFixedAVX2(u, n0, n1), LerpFixedAVX2(u, n2, n3));
+}
+
+__attribute__((target("avx2")))
+void noise::kernels::PerlinSpanFixedAVX2(const FixedSpan &span, const uint16_t *x, int16_t *out, unsigned count, int16_t scale)
+{
+    __m256i s = _mm256_set1_epi16(scale);
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i sum = _mm256_loadu_si256((const __m256i *)(out + i));
+        __m256i value = SpanFixedAVX2(span, _mm256_loadu_si256((const __m256i *)(x + i)));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_adds_epi16(sum, _mm256_mulhrs_epi16(value, s)));
+    }
+    if (i < count) {
+        alignas(32) uint16_t tailX[16] = {};
+        alignas(32) int16_t tailOut[16] = {};
+        std::copy(x + i, x + count, tailX);
+        std::copy(out + i, out + count, tailOut);
+        __m256i value = SpanFixedAVX2(span, _mm256_load_si256((const __m256i *)tailX));
+        _mm256_store_si256((__m256i *)tailOut, _mm256_adds_epi16(_mm256_load_si256((const __m256i *)tailOut), _mm256_mulhrs_epi16(value, s)));
+        std::copy(tailOut, tailOut + count - i, out + i);
+    }
+}
+
+// Corner value of a gradient, also handing out the gradient's x and y components
+__attribute__((target("avx2")))
+static inline __m256 CornerAVX2(__m256i hash, __m256 dx, __m256 dy, __m256 dz, __m256 &gx, __m256 &gy)
+{
+    __m256 gz;
+    GradVectorAVX2(hash, gx, gy, gz);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy)), _mm256_mul_ps(gz, dz));
+}
+
+// Value and slopes along x and y of one octave, the expressions of PerlinNoise::SampleGradient
+__attribute__((target("avx2")))
+static void SampleGradientAVX2(const Lattice &lattice, __m256 x, __m256 y, __m256 z, __m256 *result)
+{
+    __m256i h[8];
+    CornersAVX2(lattice, _mm256_cvttps_epi32(x), _mm256_cvttps_epi32(y), _mm256_cvttps_epi32(z), h, false);
+
+    __m256 fone = _mm256_set1_ps(1.0f);
+    __m256 xr = _mm256_sub_ps(x, _mm256_floor_ps(x)), yr = _mm256_sub_ps(y, _mm256_floor_ps(y)), zr = _mm256_sub_ps(z, _mm256_floor_ps(z));
+    __m256 xr1 = _mm256_sub_ps(xr, fone), yr1 = _mm256_sub_ps(yr, fone), zr1 = _mm256_sub_ps(zr, fone);
+    __m256 u = EaseAVX2(xr), v = EaseAVX2(yr), w = EaseAVX2(zr);
+
+    __m256 gx[8], gy[8];
+    __m256 n0 = CornerAVX2(h[0], xr, yr, zr, gx[0], gy[0]), n1 = CornerAVX2(h[1], xr1, yr, zr, gx[1], gy[1]);
+    __m256 n2 = CornerAVX2(h[2], xr, yr1, zr, gx[2], gy[2]), n3 = CornerAVX2(h[3], xr1, yr1, zr, gx[3], gy[3]);
+    __m256 n4 = CornerAVX2(h[4], xr, yr, zr1, gx[4], gy[4]), n5 = CornerAVX2(h[5], xr1, yr, zr1, gx[5], gy[5]);
+    __m256 n6 = CornerAVX2(h[6], xr, yr1, zr1, gx[6], gy[6]), n7 = CornerAVX2(h[7], xr1, yr1, zr1, gx[7], gy[7]);
+
+    __m256 sx = LerpAVX2(w, LerpAVX2(v, _mm256_sub_ps(n1, n0), _mm256_sub_ps(n3, n2)), LerpAVX2(v, _mm256_sub_ps(n5, n4), _mm256_sub_ps(n7, n6)));
+    __m256 sy = LerpAVX2(w, LerpAVX2(u, _mm256_sub_ps(n2, n0), _mm256_sub_ps(n3, n1)), LerpAVX2(u, _mm256_sub_ps(n6, n4), _mm256_sub_ps(n7, n5)));
+    __m256 bx = LerpAVX2(w, LerpAVX2(v, LerpAVX2(u, gx[0], gx[1]), LerpAVX2(u, gx[2], gx[3])), LerpAVX2(v, LerpAVX2(u, gx[4], gx[5]), LerpAVX2(u, gx[6], gx[7])));
+    __m256 by = LerpAVX2(w, LerpAVX2(v, LerpAVX2(u, gy[0], gy[1]), LerpAVX2(u, gy[2], gy[3])), LerpAVX2(v, LerpAVX2(u, gy[4], gy[5]), LerpAVX2(u, gy[6], gy[7])));
+
+    result[0] = LerpAVX2(w, LerpAVX2(v, LerpAVX2(u, n0, n1), LerpAVX2(u, n2, n3)),
+                            LerpAVX2(v, LerpAVX2(u, n4, n5), LerpAVX2(u, n6, n7)));
+    result[1] = _mm256_add_ps(_mm256_mul_ps(EaseSlopeAVX2(xr), sx), bx);
+    result[2] = _mm256_add_ps(_mm256_mul_ps(EaseSlopeAVX2(yr), sy), by);
+}
+
+__attribute__((target("avx2")))
+static void SampleGradient2DAVX2(const Lattice &lattice, __m256 x, __m256 y, __m256 *result)
+{
+    __m256i h[4];
+    CornersAVX2(lattice, _mm256_cvttps_epi32(x), _mm256_cvttps_epi32(y), _mm256_setzero_si256(), h, true);
+
+    __m256 fone = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    __m256 xr = _mm256_sub_ps(x, _mm256_floor_ps(x)), yr = _mm256_sub_ps(y, _mm256_floor_ps(y));
+    __m256 xr1 = _mm256_sub_ps(xr, fone), yr1 = _mm256_sub_ps(yr, fone);
+    __m256 u = EaseAVX2(xr), v = EaseAVX2(yr);
+
+    __m256 gx[4], gy[4];
+    __m256 n0 = CornerAVX2(h[0], xr, yr, zero, gx[0], gy[0]), n1 = CornerAVX2(h[1], xr1, yr, zero, gx[1], gy[1]);
+    __m256 n2 = CornerAVX2(h[2], xr, yr1, zero, gx[2], gy[2]), n3 = CornerAVX2(h[3], xr1, yr1, zero, gx[3], gy[3]);
+
+    __m256 sx = LerpAVX2(v, _mm256_sub_ps(n1, n0), _mm256_sub_ps(n3, n2));
+    __m256 sy = LerpAVX2(u, _mm256_sub_ps(n2, n0), _mm256_sub_ps(n3, n1));
+    __m256 bx = LerpAVX2(v, LerpAVX2(u, gx[0], gx[1]), LerpAVX2(u, gx[2], gx[3]));
+    __m256 by = LerpAVX2(v, LerpAVX2(u, gy[0], gy[1]), LerpAVX2(u, gy[2], gy[3]));
+
+    result[0] = LerpAVX2(v, LerpAVX2(u, n0, n1), LerpAVX2(u, n2, n3));
+    result[1] = _mm256_add_ps(_mm256_mul_ps(EaseSlopeAVX2(xr), sx), bx);
+    result[2] = _mm256_add_ps(_mm256_mul_ps(EaseSlopeAVX2(yr), sy), by);
+}
+
+__attribute__((target("avx2")))
+static void FractalGradientAVX2(const Lattice &lattice, const FractalParams &params, __m256 x, __m256 y, __m256 z, bool planar, __m256 *result)
+{
+    __m256 sum[3] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (weight > 0) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 sample[3];
+            if (planar) {
+                SampleGradient2DAVX2(lattice, _mm256_mul_ps(x, f), _mm256_mul_ps(y, f), sample);
+            } else {
+                SampleGradientAVX2(lattice, _mm256_mul_ps(x, f), _mm256_mul_ps(y, f), _mm256_mul_ps(z, f), sample);
+            }
+            float scale = amplitude * weight;
+            sum[0] = _mm256_add_ps(sum[0], _mm256_mul_ps(sample[0], _mm256_set1_ps(scale)));
+            sum[1] = _mm256_add_ps(sum[1], _mm256_mul_ps(sample[1], _mm256_set1_ps(scale * frequency)));
+            sum[2] = _mm256_add_ps(sum[2], _mm256_mul_ps(sample[2], _mm256_set1_ps(scale * frequency)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    for (unsigned j = 0; j < 3; j++) {
+        result[j] = _mm256_div_ps(sum[j], _mm256_set1_ps(max));
+    }
+}
+
+__attribute__((target("avx2")))
+void noise::kernels::PerlinGradientAVX2(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count)
+{
+    bool planar = !z;
+    __m256 result[3];
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 zi = planar ? _mm256_setzero_ps() : _mm256_loadu_ps(z + i);
+        FractalGradientAVX2(lattice, params, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), zi, planar, result);
+        _mm256_storeu_ps(out + i, result[0]);
+        _mm256_storeu_ps(dx + i, result[1]);
+        _mm256_storeu_ps(dy + i, result[2]);
+    }
+    if (i < count) {
+        alignas(32) float tail[6][8] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (!planar) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        FractalGradientAVX2(lattice, params, _mm256_load_ps(tail[0]), _mm256_load_ps(tail[1]), _mm256_load_ps(tail[2]), planar, result);
+        for (unsigned j = 0; j < 3; j++) {
+            _mm256_store_ps(tail[3 + j], result[j]);
+        }
+        std::copy(tail[3], tail[3] + count - i, out + i);
+        std::copy(tail[4], tail[4] + count - i, dx + i);
+        std::copy(tail[5], tail[5] + count - i, dy + i);
+    }
+}
+
+// AVX-512, 16 lanes, a single permute covers all sixteen gradients
+
+__attribute__((target("avx512f")))
+static inline __m512 EaseAVX512(__m512 p)
+{
+    __m512 inner = _mm512_add_ps(_mm512_mul_ps(p, _mm512_sub_ps(_mm512_mul_ps(p, _mm512_set1_ps(6)), _mm512_set1_ps(15))), _mm512_set1_ps(10));
+    return _mm512_mul_ps(_mm512_mul_ps(_mm512_mul_ps(p, p), p), inner);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 EaseSlopeAVX512(__m512 p)
+{
+    __m512 q = _mm512_mul_ps(p, _mm512_sub_ps(p, _mm512_set1_ps(1)));
+    return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(30), q), q);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 LerpAVX512(__m512 t, __m512 a, __m512 b)
+{
+    return _mm512_add_ps(a, _mm512_mul_ps(t, _mm512_sub_ps(b, a)));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 FloorAVX512(__m512 v)
+{
+    return _mm512_roundscale_ps(v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i LookupAVX512(const unsigned *p, __m512i i)
+{
+    return _mm512_i32gather_epi32(_mm512_and_si512(i, _mm512_set1_epi32(255)), (const int *)p, 4);
+}
+
+__attribute__((target("avx512f")))
+static inline void GradVectorAVX512(__m512i hash, __m512 &gx, __m512 &gy, __m512 &gz)
+{
+    gx = _mm512_permutexvar_ps(hash, _mm512_load_ps(gradX));
+    gy = _mm512_permutexvar_ps(hash, _mm512_load_ps(gradY));
+    gz = _mm512_permutexvar_ps(hash, _mm512_load_ps(gradZ));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 GradAVX512(__m512i hash, __m512 dx, __m512 dy, __m512 dz)
+{
+    __m512 gx, gy, gz;
+    GradVectorAVX512(hash, gx, gy, gz);
+    return _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(gx, dx), _mm512_mul_ps(gy, dy)), _mm512_mul_ps(gz, dz));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i LatticeHashAVX512(__m512i hx, __m512i hy, __m512i hz, __m512i seed)
+{
+    __m512i h = _mm512_xor_si512(_mm512_xor_si512(seed, hx), _mm512_xor_si512(hy, hz));
+    h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+    h = _mm512_mullo_epi32(h, _mm512_set1_epi32(latticeMix1));
+    h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 15));
+    h = _mm512_mullo_epi32(h, _mm512_set1_epi32(latticeMix2));
+    return _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+}
+
+// Hashes of the cell corners in the order x, then y, then z: h[1] is x + 1, h[2] is y + 1 and so on.
+// The 2D variant only fills the four corners of the z = 0 face.
+__attribute__((target("avx512f")))
+static inline void CornersAVX512(const Lattice &lattice, __m512i X, __m512i Y, __m512i Z, __m512i *h, bool planar)
+{
+    const unsigned *p = lattice.permutation;
+    __m512i one = _mm512_set1_epi32(1);
+
+    if (!p) {
+        // The per-axis products are shared between corners
+        __m512i hx[2] = { _mm512_mullo_epi32(X, _mm512_set1_epi32(latticeX)), _mm512_mullo_epi32(_mm512_add_epi32(X, one), _mm512_set1_epi32(latticeX)) };
+        __m512i hy[2] = { _mm512_mullo_epi32(Y, _mm512_set1_epi32(latticeY)), _mm512_mullo_epi32(_mm512_add_epi32(Y, one), _mm512_set1_epi32(latticeY)) };
+        __m512i hz[2] = { _mm512_setzero_si512(), _mm512_setzero_si512() };
+        if (!planar) {
+            hz[0] = _mm512_mullo_epi32(Z, _mm512_set1_epi32(latticeZ));
+            hz[1] = _mm512_mullo_epi32(_mm512_add_epi32(Z, one), _mm512_set1_epi32(latticeZ));
+        }
+        __m512i seed = _mm512_set1_epi32(lattice.seed);
+        for (unsigned c = 0; c < (planar ? 4u : 8u); c++) {
+            h[c] = LatticeHashAVX512(hx[c & 1], hy[c >> 1 & 1], hz[c >> 2], seed);
+        }
+        return;
+    }
+
+    __m512i A = _mm512_add_epi32(LookupAVX512(p, X), Y);
+    __m512i B = _mm512_add_epi32(LookupAVX512(p, _mm512_add_epi32(X, one)), Y);
+    if (planar) {
+        h[0] = LookupAVX512(p, LookupAVX512(p, A));
+        h[1] = LookupAVX512(p, LookupAVX512(p, B));
+        h[2] = LookupAVX512(p, LookupAVX512(p, _mm512_add_epi32(A, one)));
+        h[3] = LookupAVX512(p, LookupAVX512(p, _mm512_add_epi32(B, one)));
+        return;
+    }
+    __m512i AA = _mm512_add_epi32(LookupAVX512(p, A), Z);
+    __m512i AB = _mm512_add_epi32(LookupAVX512(p, _mm512_add_epi32(A, one)), Z);
+    __m512i BA = _mm512_add_epi32(LookupAVX512(p, B), Z);
+    __m512i BB = _mm512_add_epi32(LookupAVX512(p, _mm512_add_epi32(B, one)), Z);
+    h[0] = LookupAVX512(p, AA);
+    h[1] = LookupAVX512(p, BA);
+    h[2] = LookupAVX512(p, AB);
+    h[3] = LookupAVX512(p, BB);
+    h[4] = LookupAVX512(p, _mm512_add_epi32(AA, one));
+    h[5] = LookupAVX512(p, _mm512_add_epi32(BA, one));
+    h[6] = LookupAVX512(p, _mm512_add_epi32(AB, one));
+    h[7] = LookupAVX512(p, _mm512_add_epi32(BB, one));
+}
+
+__attribute__((target("avx512f")))
+static __m512 SampleAVX512(const Lattice &lattice, __m512 x, __m512 y, __m512 z)
+{
+    __m512i h[8];
+    CornersAVX512(lattice, _mm512_cvttps_epi32(x), _mm512_cvttps_epi32(y), _mm512_cvttps_epi32(z), h, false);
+
+    __m512 fone = _mm512_set1_ps(1.0f);
+    __m512 xr = _mm512_sub_ps(x, FloorAVX512(x)), yr = _mm512_sub_ps(y, FloorAVX512(y)), zr = _mm512_sub_ps(z, FloorAVX512(z));
+    __m512 xr1 = _mm512_sub_ps(xr, fone), yr1 = _mm512_sub_ps(yr, fone), zr1 = _mm512_sub_ps(zr, fone);
+    __m512 u = EaseAVX512(xr), v = EaseAVX512(yr), w = EaseAVX512(zr);
+
+    return LerpAVX512(w, LerpAVX512(v, LerpAVX512(u, GradAVX512(h[0], xr, yr, zr), GradAVX512(h[1], xr1, yr, zr)),
+                                       LerpAVX512(u, GradAVX512(h[2], xr, yr1, zr), GradAVX512(h[3], xr1, yr1, zr))),
+                         LerpAVX512(v, LerpAVX512(u, GradAVX512(h[4], xr, yr, zr1), GradAVX512(h[5], xr1, yr, zr1)),
+                                       LerpAVX512(u, GradAVX512(h[6], xr, yr1, zr1), GradAVX512(h[7], xr1, yr1, zr1))));
+}
+
+__attribute__((target("avx512f")))
+static __m512 Sample2DAVX512(const Lattice &lattice, __m512 x, __m512 y)
+{
+    __m512i h[4];
+    CornersAVX512(lattice, _mm512_cvttps_epi32(x), _mm512_cvttps_epi32(y), _mm512_setzero_si512(), h, true);
+
+    __m512 fone = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+    __m512 xr = _mm512_sub_ps(x, FloorAVX512(x)), yr = _mm512_sub_ps(y, FloorAVX512(y));
+    __m512 xr1 = _mm512_sub_ps(xr, fone), yr1 = _mm512_sub_ps(yr, fone);
+    __m512 u = EaseAVX512(xr), v = EaseAVX512(yr);
+
+    return LerpAVX512(v, LerpAVX512(u, GradAVX512(h[0], xr, yr, zero), GradAVX512(h[1], xr1, yr, zero)),
+                         LerpAVX512(u, GradAVX512(h[2], xr, yr1, zero), GradAVX512(h[3], xr1, yr1, zero)));
+}
+
+__attribute__((target("avx512f")))
+static __m512 FractalAVX512(const Lattice &lattice, const FractalParams &params, __m512 x, __m512 y, __m512 z, __m512 sum, bool planar)
+{
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (i >= params.first && weight > 0) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 sample = planar ? Sample2DAVX512(lattice, _mm512_mul_ps(x, f), _mm512_mul_ps(y, f))
+                                   : SampleAVX512(lattice, _mm512_mul_ps(x, f), _mm512_mul_ps(y, f), _mm512_mul_ps(z, f));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(sample, _mm512_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm512_div_ps(sum, _mm512_set1_ps(max));
+}
+
+__attribute__((target("avx512f")))
+void noise::kernels::PerlinAVX512(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    bool planar = !z;
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 zi = planar ? _mm512_setzero_ps() : _mm512_loadu_ps(z + i);
+        __m512 sum = params.first ? _mm512_loadu_ps(out + i) : _mm512_setzero_ps();
+        _mm512_storeu_ps(out + i, FractalAVX512(lattice, params, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), zi, sum, planar));
+    }
+    if (i < count) {
+        alignas(64) float tail[4][16] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (!planar) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        if (params.first) {
+            std::copy(out + i, out + count, tail[3]);
+        }
+        _mm512_store_ps(tail[3], FractalAVX512(lattice, params, _mm512_load_ps(tail[0]), _mm512_load_ps(tail[1]), _mm512_load_ps(tail[2]), _mm512_load_ps(tail[3]), planar));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+// Corner value of a gradient, also handing out the gradient's x and y components
+__attribute__((target("avx512f")))
+static inline __m512 CornerAVX512(__m512i hash, __m512 dx, __m512 dy, __m512 dz, __m512 &gx, __m512 &gy)
+{
+    __m512 gz;
+    GradVectorAVX512(hash, gx, gy, gz);
+    return _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(gx, dx), _mm512_mul_ps(gy, dy)), _mm512_mul_ps(gz, dz));
+}
+
+// Value and slopes along x and y of one octave, the expressions of PerlinNoise::SampleGradient
+__attribute__((target("avx512f")))
+static void SampleGradientAVX512(const Lattice &lattice, __m512 x, __m512 y, __m512 z, __m512 *result)
+{
+    __m512i h[8];
+    CornersAVX512(lattice, _mm512_cvttps_epi32(x), _mm512_cvttps_epi32(y), _mm512_cvttps_epi32(z), h, false);
+
+    __m512 fone = _mm512_set1_ps(1.0f);
+    __m512 xr = _mm512_sub_ps(x, FloorAVX512(x)), yr = _mm512_sub_ps(y, FloorAVX512(y)), zr = _mm512_sub_ps(z, FloorAVX512(z));
+    __m512 xr1 = _mm512_sub_ps(xr, fone), yr1 = _mm512_sub_ps(yr, fone), zr1 = _mm512_sub_ps(zr, fone);
+    __m512 u = EaseAVX512(xr), v = EaseAVX512(yr), w = EaseAVX512(zr);
+
+    __m512 gx[8], gy[8];
+    __m512 n0 = CornerAVX512(h[0], xr, yr, zr, gx[0], gy[0]), n1 = CornerAVX512(h[1], xr1, yr, zr, gx[1], gy[1]);
+    __m512 n2 = CornerAVX512(h[2], xr, yr1, zr, gx[2], gy[2]), n3 = CornerAVX512(h[3], xr1, yr1, zr, gx[3], gy[3]);
+    __m512 n4 = CornerAVX512(h[4], xr, yr, zr1, gx[4], gy[4]), n5 = CornerAVX512(h[5], xr1, yr, zr1, gx[5], gy[5]);
+    __m512 n6 = CornerAVX512(h[6], xr, yr1, zr1, gx[6], gy[6]), n7 = CornerAVX512(h[7], xr1, yr1, zr1, gx[7], gy[7]);
+
+    __m512 sx = LerpAVX512(w, LerpAVX512(v, _mm512_sub_ps(n1, n0), _mm512_sub_ps(n3, n2)), LerpAVX512(v, _mm512_sub_ps(n5, n4), _mm512_sub_ps(n7, n6)));
+    __m512 sy = LerpAVX512(w, LerpAVX512(u, _mm512_sub_ps(n2, n0), _mm512_sub_ps(n3, n1)), LerpAVX512(u, _mm512_sub_ps(n6, n4), _mm512_sub_ps(n7, n5)));
+    __m512 bx = LerpAVX512(w, LerpAVX512(v, LerpAVX512(u, gx[0], gx[1]), LerpAVX512(u, gx[2], gx[3])), LerpAVX512(v, LerpAVX512(u, gx[4], gx[5]), LerpAVX512(u, gx[6], gx[7])));
+    __m512 by = LerpAVX512(w, LerpAVX512(v, LerpAVX512(u, gy[0], gy[1]), LerpAVX512(u, gy[2], gy[3])), LerpAVX512(v, LerpAVX512(u, gy[4], gy[5]), LerpAVX512(u, gy[6], gy[7])));
+
+    result[0] = LerpAVX512(w, LerpAVX512(v, LerpAVX512(u, n0, n1), LerpAVX512(u, n2, n3)),
+                            LerpAVX512(v, LerpAVX512(u, n4, n5), LerpAVX512(u, n6, n7)));
+    result[1] = _mm512_add_ps(_mm512_mul_ps(EaseSlopeAVX512(xr), sx), bx);
+    result[2] = _mm512_add_ps(_mm512_mul_ps(EaseSlopeAVX512(yr), sy), by);
+}
+
+__attribute__((target("avx512f")))
+static void SampleGradient2DAVX512(const Lattice &lattice, __m512 x, __m512 y, __m512 *result)
+{
+    __m512i h[4];
+    CornersAVX512(lattice, _mm512_cvttps_epi32(x), _mm512_cvttps_epi32(y), _mm512_setzero_si512(), h, true);
+
+    __m512 fone = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+    __m512 xr = _mm512_sub_ps(x, FloorAVX512(x)), yr = _mm512_sub_ps(y, FloorAVX512(y));
+    __m512 xr1 = _mm512_sub_ps(xr, fone), yr1 = _mm512_sub_ps(yr, fone);
+    __m512 u = EaseAVX512(xr), v = EaseAVX512(yr);
+
+    __m512 gx[4], gy[4];
+    __m512 n0 = CornerAVX512(h[0], xr, yr, zero, gx[0], gy[0]), n1 = CornerAVX512(h[1], xr1, yr, zero, gx[1], gy[1]);
+    __m512 n2 = CornerAVX512(h[2], xr, yr1, zero, gx[2], gy[2]), n3 = CornerAVX512(h[3], xr1, yr1, zero, gx[3], gy[3]);
+
+    __m512 sx = LerpAVX512(v, _mm512_sub_ps(n1, n0), _mm512_sub_ps(n3, n2));
+    __m512 sy = LerpAVX512(u, _mm512_sub_ps(n2, n0), _mm512_sub_ps(n3, n1));
+    __m512 bx = LerpAVX512(v, LerpAVX512(u, gx[0], gx[1]), LerpAVX512(u, gx[2], gx[3]));
+    __m512 by = LerpAVX512(v, LerpAVX512(u, gy[0], gy[1]), LerpAVX512(u, gy[2], gy[3]));
+
+    result[0] = LerpAVX512(v, LerpAVX512(u, n0, n1), LerpAVX512(u, n2, n3));
+    result[1] = _mm512_add_ps(_mm512_mul_ps(EaseSlopeAVX512(xr), sx), bx);
+    result[2] = _mm512_add_ps(_mm512_mul_ps(EaseSlopeAVX512(yr), sy), by);
+}
+
+__attribute__((target("avx512f")))
+static void FractalGradientAVX512(const Lattice &lattice, const FractalParams &params, __m512 x, __m512 y, __m512 z, bool planar, __m512 *result)
+{
+    __m512 sum[3] = { _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps() };
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (weight > 0) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 sample[3];
+            if (planar) {
+                SampleGradient2DAVX512(lattice, _mm512_mul_ps(x, f), _mm512_mul_ps(y, f), sample);
+            } else {
+                SampleGradientAVX512(lattice, _mm512_mul_ps(x, f), _mm512_mul_ps(y, f), _mm512_mul_ps(z, f), sample);
+            }
+            float scale = amplitude * weight;
+            sum[0] = _mm512_add_ps(sum[0], _mm512_mul_ps(sample[0], _mm512_set1_ps(scale)));
+            sum[1] = _mm512_add_ps(sum[1], _mm512_mul_ps(sample[1], _mm512_set1_ps(scale * frequency)));
+            sum[2] = _mm512_add_ps(sum[2], _mm512_mul_ps(sample[2], _mm512_set1_ps(scale * frequency)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    for (unsigned j = 0; j < 3; j++) {
+        result[j] = _mm512_div_ps(sum[j], _mm512_set1_ps(max));
+    }
+}
+
+__attribute__((target("avx512f")))
+void noise::kernels::PerlinGradientAVX512(const Lattice &lattice, const FractalParams &params, const float *x, const float *y, const float *z, float *out, float *dx, float *dy, unsigned count)
+{
+    bool planar = !z;
+    __m512 result[3];
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 8) {
+        __m512 zi = planar ? _mm512_setzero_ps() : _mm512_loadu_ps(z + i);
+        FractalGradientAVX512(lattice, params, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), zi, planar, result);
+        _mm512_storeu_ps(out + i, result[0]);
+        _mm512_storeu_ps(dx + i, result[1]);
+        _mm512_storeu_ps(dy + i, result[2]);
+    }
+    if (i < count) {
+        alignas(64) float tail[6][16] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (!planar) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        FractalGradientAVX512(lattice, params, _mm512_load_ps(tail[0]), _mm512_load_ps(tail[1]), _mm512_load_ps(tail[2]), planar, result);
+        for (unsigned j = 0; j < 3; j++) {
+            _mm512_store_ps(tail[3 + j], result[j]);
+        }
+        std::copy(tail[3], tail[3] + count - i, out + i);
+        std::copy(tail[4], tail[4] + count - i, dx + i);
+        std::copy(tail[5], tail[5] + count - i, dy + i);
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 SpanCornerAVX512(const GridSpan &span, unsigned c, __m512 dx)
+{
+    return _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(span.gx[c]), dx), _mm512_set1_ps(span.ty[c])), _mm512_set1_ps(span.tz[c]));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 SpanAVX512(const GridSpan &span, __m512 x)
+{
+    __m512 xr = _mm512_sub_ps(x, FloorAVX512(x)), xr1 = _mm512_sub_ps(xr, _mm512_set1_ps(1.0f));
+    __m512 u = EaseAVX512(xr), v = _mm512_set1_ps(span.v);
+
+    __m512 front = LerpAVX512(v, LerpAVX512(u, SpanCornerAVX512(span, 0, xr), SpanCornerAVX512(span, 1, xr1)),
+                               LerpAVX512(u, SpanCornerAVX512(span, 2, xr), SpanCornerAVX512(span, 3, xr1)));
+    if (span.planar) {
+        return front;
+    }
+    __m512 back = LerpAVX512(v, LerpAVX512(u, SpanCornerAVX512(span, 4, xr), SpanCornerAVX512(span, 5, xr1)),
+                              LerpAVX512(u, SpanCornerAVX512(span, 6, xr), SpanCornerAVX512(span, 7, xr1)));
+    return LerpAVX512(_mm512_set1_ps(span.w), front, back);
+}
+
+__attribute__((target("avx512f")))
+void noise::kernels::PerlinSpanAVX512(const GridSpan &span, const float *x, float *out, unsigned count, float scale)
+{
+    __m512 s = _mm512_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(out + i), _mm512_mul_ps(SpanAVX512(span, _mm512_loadu_ps(x + i)), s)));
+    }
+    if (i < count) {
+        alignas(64) float tail[2][16] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(out + i, out + count, tail[1]);
+        _mm512_store_ps(tail[1], _mm512_add_ps(_mm512_load_ps(tail[1]), _mm512_mul_ps(SpanAVX512(span, _mm512_load_ps(tail[0])), s)));
+        std::copy(tail[1], tail[1] + count - i, out + i);
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "PreviewRenderer.h"
+#include <algorithm>
+
+PreviewRenderer::PreviewRenderer(unsigned size) : imageSize(size), cancel(false), stopping(false), readySize(0), hasReady(false)
+{
+    worker = std::thread(&PreviewRenderer::WorkerLoop, this);
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void PreviewRenderer::Request(const Node *node)
+{
+    // Compiling copies every parameter the render needs, so it is safe to edit the graph afterwards
+    std::unique_ptr<NodeProgram> program(new NodeProgram(NodeCompiler::Compile(node)));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(program);
+        cancel = true;
+    }
+    wake.notify_one();
+}
+
+bool PreviewRenderer::Poll(NodeRenderer::ImageData &image, unsigned &size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!hasReady) {
+        return false;
+    }
+    image.swap(ready);
+    size = readySize;
+    hasReady = false;
+    return true;
+}
+
+void PreviewRenderer::WorkerLoop()
+{
+    while (true) {
+        std::unique_ptr<NodeProgram> program;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            program = std::move(pending);
+            cancel = false;
+        }
+
+        for (unsigned level = 8; level >= 1; level /= 2) {
+            unsigned size = std::max(1u, imageSize / level);
+
+            NodeRenderer renderer(size);
+            renderer.CancelFlag(&cancel);
+            renderer.LimitOctaves(true);
+            renderer.FixedPoint(true);
+            const NodeRenderer::ImageData &image = renderer.Render(*program);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cancel) {
+                break;
+            }
+            ready = image;
+            readySize = size;
+            hasReady = true;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "Simd.h"
+#include <atomic>
+
+using namespace noise;
+
+static SimdLevel Detect()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+static std::atomic<int> activeLevel(-1);
+
+SimdLevel noise::DetectedSimdLevel()
+{
+    static const SimdLevel detected = Detect();
+    return detected;
+}
+
+SimdLevel noise::ActiveSimdLevel()
+{
+    int level = activeLevel.load(std::memory_order_relaxed);
+    return level < 0 ? DetectedSimdLevel() : (SimdLevel)level;
+}
+
+void noise::ActiveSimdLevel(SimdLevel level)
+{
+    if (level > DetectedSimdLevel()) {
+        level = DetectedSimdLevel();
+    }
+    activeLevel.store((int)level, std::memory_order_relaxed);
+}
+
+const char *noise::SimdLevelName(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default: return "Scalar";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "SimplexNoise.h"
+#include "NoiseKernels.h"
+#include "Simd.h"
+#include <random>
+#include <algorithm>
+
+using namespace noise;
+
+// Skews space onto the simplex grid and back
+static const float skew = 1.0f / 3.0f;
+static const float unskew = 1.0f / 6.0f;
+
+// Scales the sum of the corner contributions to about [-1, 1]
+static const float scale = 76.0f;
+
+SimplexNoise::SimplexNoise(uint64_t seed)
+{
+    Seed(seed);
+}
+
+unsigned SimplexNoise::Hash(int x, int y, int z) const
+{
+    unsigned a = permutation[x & 255] + y;
+    unsigned b = permutation[a & 255] + z;
+    return permutation[b & 255];
+}
+
+// The gradients of PerlinNoise::Grad as coefficients of (dx, dy, dz), indexed by hash
+static const float gradX[16] = { 1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0,  1,  0, -1,  0 };
+static const float gradY[16] = { 1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1,  1, -1,  1, -1 };
+static const float gradZ[16] = { 0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1,  0,  1,  0, -1 };
+
+static inline int FastFloor(float v)
+{
+    int i = (int)v;
+    return v < i ? i - 1 : i;
+}
+
+// Contribution of one corner, its gradient fades out at a distance of sqrt(0.5) so neighbouring
+// simplices join without seams
+float SimplexNoise::Corner(int x, int y, int z, float dx, float dy, float dz) const
+{
+    float t = std::max(0.5f - dx * dx - dy * dy - dz * dz, 0.0f);
+    unsigned h = Hash(x, y, z) & 15;
+
+    t *= t;
+    return t * t * (gradX[h] * dx + gradY[h] * dy + gradZ[h] * dz);
+}
+
+float SimplexNoise::Sample(float x, float y, float z) const
+{
+    // Cell of the skewed grid and the sample's offset from its origin
+    float s = (x + y + z) * skew;
+    int i = FastFloor(x + s),
+        j = FastFloor(y + s),
+        k = FastFloor(z + s);
+    float t = (i + j + k) * unskew;
+    float x0 = x - (i - t),
+          y0 = y - (j - t),
+          z0 = z - (k - t);
+
+    // Ranking the offset's components picks which of the cell's six tetrahedra holds the sample.
+    // The second corner steps along the largest component, the third along the two largest.
+    int rx = (x0 >= y0) + (x0 >= z0),
+        ry = (y0 > x0) + (y0 >= z0),
+        rz = (z0 > x0) + (z0 > y0);
+    int i1 = rx >= 2, j1 = ry >= 2, k1 = rz >= 2;
+    int i2 = rx >= 1, j2 = ry >= 1, k2 = rz >= 1;
+
+    float sum = Corner(i, j, k, x0, y0, z0)
+              + Corner(i + i1, j + j1, k + k1, x0 - i1 + unskew, y0 - j1 + unskew, z0 - k1 + unskew)
+              + Corner(i + i2, j + j2, k + k2, x0 - i2 + 2 * unskew, y0 - j2 + 2 * unskew, z0 - k2 + 2 * unskew)
+              + Corner(i + 1, j + 1, k + 1, x0 - 1 + 3 * unskew, y0 - 1 + 3 * unskew, z0 - 1 + 3 * unskew);
+    return sum * scale;
+}
+
+float SimplexNoise::Sample(float x, float y, float z, unsigned octaves, float frequency, float persistence, float lacunarity) const
+{
+    float sum = 0;
+    float amplitude = 1;
+    float max = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        sum += Sample(x * frequency, y * frequency, z * frequency) * amplitude;
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    return sum / max;
+}
+
+void SimplexNoise::Sample(const float *x, const float *y, const float *z, float *out, unsigned count, unsigned octaves, float frequency, float persistence, float lacunarity, float spacing) const
+{
+#ifdef NOISE_X86_KERNELS
+    kernels::FractalParams params = { octaves, frequency, persistence, lacunarity, spacing };
+    switch (ActiveSimdLevel()) {
+        case SimdLevel::AVX512: kernels::SimplexAVX512(permutation, params, x, y, z, out, count); return;
+        case SimdLevel::AVX2: kernels::SimplexAVX2(permutation, params, x, y, z, out, count); return;
+        case SimdLevel::SSE2: kernels::SimplexSSE2(permutation, params, x, y, z, out, count); return;
+        default: break;
+    }
+#endif
+
+    std::fill(out, out + count, 0.0f);
+
+    float amplitude = 1;
+    float max = 0;
+    for (unsigned i = 0; i < octaves; i++) {
+        float weight = kernels::OctaveWeight(frequency, spacing);
+        for (unsigned j = 0; weight > 0 && j < count; j++) {
+            out[j] += Sample(x[j] * frequency, y[j] * frequency, (z ? z[j] : 0.0f) * frequency) * (amplitude * weight);
+        }
+
+        max += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    for (unsigned j = 0; j < count; j++) {
+        out[j] /= max;
+    }
+}
+
+void SimplexNoise::Seed(uint64_t seed)
+{
+    std::mt19937_64 prng(seed);
+
+    // From the identity, so a seed always gives the same table whatever came before it
+    for (unsigned i = 0; i < 256; i++) {
+        permutation[i] = i;
+    }
+    std::shuffle(permutation, permutation + 256, prng);
+}
+
+bool SimplexNoise::operator==(const SimplexNoise &other) const
+{
+    return std::equal(permutation, permutation + 256, other.permutation);
+}
\ No newline at end of file
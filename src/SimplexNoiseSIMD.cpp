@@ -0,0 +1,333 @@
+#include "NoiseKernels.h"
+
+#ifdef NOISE_X86_KERNELS
+
+#include <immintrin.h>
+#include <algorithm>
+
+using namespace noise::kernels;
+
+// Same constants and gradient table as SimplexNoise.cpp. Kernels follow the scalar expression order,
+// so every lane matches SimplexNoise::Sample bit for bit.
+static const float skew = 1.0f / 3.0f;
+static const float unskew = 1.0f / 6.0f;
+static const float scale = 76.0f;
+
+alignas(64) static const float gradX[16] = { 1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0,  1,  0, -1,  0 };
+alignas(64) static const float gradY[16] = { 1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1,  1, -1,  1, -1 };
+alignas(64) static const float gradZ[16] = { 0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1,  0,  1,  0, -1 };
+
+// SSE2, 4 lanes, hashes looked up per lane
+
+__attribute__((target("sse2")))
+static inline __m128 FloorSSE2(__m128 v)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 CornerSSE2(const unsigned *p, __m128i x, __m128i y, __m128i z, __m128 dx, __m128 dy, __m128 dz)
+{
+    __m128 t = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(dx, dx)), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)), _mm_setzero_ps());
+
+    alignas(16) int xi[4], yi[4], zi[4];
+    _mm_store_si128((__m128i *)xi, x);
+    _mm_store_si128((__m128i *)yi, y);
+    _mm_store_si128((__m128i *)zi, z);
+
+    unsigned h[4];
+    for (unsigned l = 0; l < 4; l++) {
+        unsigned a = p[xi[l] & 255] + yi[l];
+        unsigned b = p[a & 255] + zi[l];
+        h[l] = p[b & 255] & 15;
+    }
+    __m128 gx = _mm_setr_ps(gradX[h[0]], gradX[h[1]], gradX[h[2]], gradX[h[3]]);
+    __m128 gy = _mm_setr_ps(gradY[h[0]], gradY[h[1]], gradY[h[2]], gradY[h[3]]);
+    __m128 gz = _mm_setr_ps(gradZ[h[0]], gradZ[h[1]], gradZ[h[2]], gradZ[h[3]]);
+    __m128 g = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, dx), _mm_mul_ps(gy, dy)), _mm_mul_ps(gz, dz));
+
+    t = _mm_mul_ps(t, t);
+    return _mm_mul_ps(_mm_mul_ps(t, t), g);
+}
+
+__attribute__((target("sse2")))
+static __m128 SampleSSE2(const unsigned *p, __m128 x, __m128 y, __m128 z)
+{
+    __m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), _mm_set1_ps(skew));
+    __m128i i = _mm_cvttps_epi32(FloorSSE2(_mm_add_ps(x, s))),
+            j = _mm_cvttps_epi32(FloorSSE2(_mm_add_ps(y, s))),
+            k = _mm_cvttps_epi32(FloorSSE2(_mm_add_ps(z, s)));
+    __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), _mm_set1_ps(unskew));
+    __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t)),
+           y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t)),
+           z0 = _mm_sub_ps(z, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+    // Ranks of the offset's components as masks, see SimplexNoise::Sample
+    __m128 xy = _mm_cmpge_ps(x0, y0), xz = _mm_cmpge_ps(x0, z0);
+    __m128 yx = _mm_cmpgt_ps(y0, x0), yz = _mm_cmpge_ps(y0, z0);
+    __m128 zx = _mm_cmpgt_ps(z0, x0), zy = _mm_cmpgt_ps(z0, y0);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 i1 = _mm_and_ps(_mm_and_ps(xy, xz), one), i2 = _mm_and_ps(_mm_or_ps(xy, xz), one);
+    __m128 j1 = _mm_and_ps(_mm_and_ps(yx, yz), one), j2 = _mm_and_ps(_mm_or_ps(yx, yz), one);
+    __m128 k1 = _mm_and_ps(_mm_and_ps(zx, zy), one), k2 = _mm_and_ps(_mm_or_ps(zx, zy), one);
+
+    __m128 u1 = _mm_set1_ps(unskew), u2 = _mm_set1_ps(2 * unskew), u3 = _mm_set1_ps(3 * unskew);
+    __m128 sum = CornerSSE2(p, i, j, k, x0, y0, z0);
+    sum = _mm_add_ps(sum, CornerSSE2(p, _mm_add_epi32(i, _mm_cvttps_epi32(i1)), _mm_add_epi32(j, _mm_cvttps_epi32(j1)), _mm_add_epi32(k, _mm_cvttps_epi32(k1)),
+                                     _mm_add_ps(_mm_sub_ps(x0, i1), u1), _mm_add_ps(_mm_sub_ps(y0, j1), u1), _mm_add_ps(_mm_sub_ps(z0, k1), u1)));
+    sum = _mm_add_ps(sum, CornerSSE2(p, _mm_add_epi32(i, _mm_cvttps_epi32(i2)), _mm_add_epi32(j, _mm_cvttps_epi32(j2)), _mm_add_epi32(k, _mm_cvttps_epi32(k2)),
+                                     _mm_add_ps(_mm_sub_ps(x0, i2), u2), _mm_add_ps(_mm_sub_ps(y0, j2), u2), _mm_add_ps(_mm_sub_ps(z0, k2), u2)));
+    __m128i ione = _mm_set1_epi32(1);
+    sum = _mm_add_ps(sum, CornerSSE2(p, _mm_add_epi32(i, ione), _mm_add_epi32(j, ione), _mm_add_epi32(k, ione),
+                                     _mm_add_ps(_mm_sub_ps(x0, one), u3), _mm_add_ps(_mm_sub_ps(y0, one), u3), _mm_add_ps(_mm_sub_ps(z0, one), u3)));
+    return _mm_mul_ps(sum, _mm_set1_ps(scale));
+}
+
+__attribute__((target("sse2")))
+static __m128 FractalSSE2(const unsigned *permutation, const FractalParams &params, __m128 x, __m128 y, __m128 z)
+{
+    __m128 sum = _mm_setzero_ps();
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (weight > 0) {
+            __m128 f = _mm_set1_ps(frequency);
+            __m128 sample = SampleSSE2(permutation, _mm_mul_ps(x, f), _mm_mul_ps(y, f), _mm_mul_ps(z, f));
+            sum = _mm_add_ps(sum, _mm_mul_ps(sample, _mm_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm_div_ps(sum, _mm_set1_ps(max));
+}
+
+__attribute__((target("sse2")))
+void noise::kernels::SimplexSSE2(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 zi = z ? _mm_loadu_ps(z + i) : _mm_setzero_ps();
+        _mm_storeu_ps(out + i, FractalSSE2(permutation, params, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), zi));
+    }
+    if (i < count) {
+        alignas(16) float tail[4][4] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (z) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        _mm_store_ps(tail[3], FractalSSE2(permutation, params, _mm_load_ps(tail[0]), _mm_load_ps(tail[1]), _mm_load_ps(tail[2])));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+// AVX2, 8 lanes, hashes with gathers
+
+__attribute__((target("avx2")))
+static inline __m256i LookupAVX2(const unsigned *p, __m256i i)
+{
+    return _mm256_i32gather_epi32((const int *)p, _mm256_and_si256(i, _mm256_set1_epi32(255)), 4);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 CornerAVX2(const unsigned *p, __m256i px, __m256i y, __m256i z, __m256 dx, __m256 dy, __m256 dz)
+{
+    __m256 t = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(dx, dx)), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)), _mm256_setzero_ps());
+
+    __m256i h = LookupAVX2(p, _mm256_add_epi32(LookupAVX2(p, _mm256_add_epi32(px, y)), z));
+
+    // permutevar only looks at the low three bits, bit 3 selects the upper half of each table
+    __m256 upper = _mm256_castsi256_ps(_mm256_slli_epi32(h, 28));
+    __m256 gx = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradX), h), _mm256_permutevar8x32_ps(_mm256_load_ps(gradX + 8), h), upper);
+    __m256 gy = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradY), h), _mm256_permutevar8x32_ps(_mm256_load_ps(gradY + 8), h), upper);
+    __m256 gz = _mm256_blendv_ps(_mm256_permutevar8x32_ps(_mm256_load_ps(gradZ), h), _mm256_permutevar8x32_ps(_mm256_load_ps(gradZ + 8), h), upper);
+    __m256 g = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy)), _mm256_mul_ps(gz, dz));
+
+    t = _mm256_mul_ps(t, t);
+    return _mm256_mul_ps(_mm256_mul_ps(t, t), g);
+}
+
+__attribute__((target("avx2")))
+static __m256 SampleAVX2(const unsigned *p, __m256 x, __m256 y, __m256 z)
+{
+    __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(skew));
+    __m256i i = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(x, s))),
+            j = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(y, s))),
+            k = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(z, s)));
+    __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), _mm256_set1_ps(unskew));
+    __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t)),
+           y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t)),
+           z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+    __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ), xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+    __m256 yx = _mm256_cmp_ps(y0, x0, _CMP_GT_OQ), yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+    __m256 zx = _mm256_cmp_ps(z0, x0, _CMP_GT_OQ), zy = _mm256_cmp_ps(z0, y0, _CMP_GT_OQ);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 i1 = _mm256_and_ps(_mm256_and_ps(xy, xz), one), i2 = _mm256_and_ps(_mm256_or_ps(xy, xz), one);
+    __m256 j1 = _mm256_and_ps(_mm256_and_ps(yx, yz), one), j2 = _mm256_and_ps(_mm256_or_ps(yx, yz), one);
+    __m256 k1 = _mm256_and_ps(_mm256_and_ps(zx, zy), one), k2 = _mm256_and_ps(_mm256_or_ps(zx, zy), one);
+
+    __m256 u1 = _mm256_set1_ps(unskew), u2 = _mm256_set1_ps(2 * unskew), u3 = _mm256_set1_ps(3 * unskew);
+    // Corners only differ by one in x, so the first hash lookup is shared: p[i] or p[i + 1]
+    __m256i ione = _mm256_set1_epi32(1);
+    __m256i pi = LookupAVX2(p, i), pi1 = LookupAVX2(p, _mm256_add_epi32(i, ione));
+    __m256 sum = CornerAVX2(p, pi, j, k, x0, y0, z0);
+    sum = _mm256_add_ps(sum, CornerAVX2(p, _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(pi), _mm256_castsi256_ps(pi1), _mm256_and_ps(xy, xz))), _mm256_add_epi32(j, _mm256_cvttps_epi32(j1)), _mm256_add_epi32(k, _mm256_cvttps_epi32(k1)),
+                                        _mm256_add_ps(_mm256_sub_ps(x0, i1), u1), _mm256_add_ps(_mm256_sub_ps(y0, j1), u1), _mm256_add_ps(_mm256_sub_ps(z0, k1), u1)));
+    sum = _mm256_add_ps(sum, CornerAVX2(p, _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(pi), _mm256_castsi256_ps(pi1), _mm256_or_ps(xy, xz))), _mm256_add_epi32(j, _mm256_cvttps_epi32(j2)), _mm256_add_epi32(k, _mm256_cvttps_epi32(k2)),
+                                        _mm256_add_ps(_mm256_sub_ps(x0, i2), u2), _mm256_add_ps(_mm256_sub_ps(y0, j2), u2), _mm256_add_ps(_mm256_sub_ps(z0, k2), u2)));
+    sum = _mm256_add_ps(sum, CornerAVX2(p, pi1, _mm256_add_epi32(j, ione), _mm256_add_epi32(k, ione),
+                                        _mm256_add_ps(_mm256_sub_ps(x0, one), u3), _mm256_add_ps(_mm256_sub_ps(y0, one), u3), _mm256_add_ps(_mm256_sub_ps(z0, one), u3)));
+    return _mm256_mul_ps(sum, _mm256_set1_ps(scale));
+}
+
+__attribute__((target("avx2")))
+static __m256 FractalAVX2(const unsigned *permutation, const FractalParams &params, __m256 x, __m256 y, __m256 z)
+{
+    __m256 sum = _mm256_setzero_ps();
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (weight > 0) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 sample = SampleAVX2(permutation, _mm256_mul_ps(x, f), _mm256_mul_ps(y, f), _mm256_mul_ps(z, f));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(sample, _mm256_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm256_div_ps(sum, _mm256_set1_ps(max));
+}
+
+__attribute__((target("avx2")))
+void noise::kernels::SimplexAVX2(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 zi = z ? _mm256_loadu_ps(z + i) : _mm256_setzero_ps();
+        _mm256_storeu_ps(out + i, FractalAVX2(permutation, params, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), zi));
+    }
+    if (i < count) {
+        alignas(32) float tail[4][8] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (z) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        _mm256_store_ps(tail[3], FractalAVX2(permutation, params, _mm256_load_ps(tail[0]), _mm256_load_ps(tail[1]), _mm256_load_ps(tail[2])));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+// AVX-512, 16 lanes, comparisons produce mask registers
+
+__attribute__((target("avx512f")))
+static inline __m512i LookupAVX512(const unsigned *p, __m512i i)
+{
+    return _mm512_i32gather_epi32(_mm512_and_si512(i, _mm512_set1_epi32(255)), (const int *)p, 4);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 CornerAVX512(const unsigned *p, __m512i px, __m512i y, __m512i z, __m512 dx, __m512 dy, __m512 dz)
+{
+    __m512 t = _mm512_max_ps(_mm512_sub_ps(_mm512_sub_ps(_mm512_sub_ps(_mm512_set1_ps(0.5f), _mm512_mul_ps(dx, dx)), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz)), _mm512_setzero_ps());
+
+    __m512i h = LookupAVX512(p, _mm512_add_epi32(LookupAVX512(p, _mm512_add_epi32(px, y)), z));
+
+    __m512 gx = _mm512_permutexvar_ps(h, _mm512_load_ps(gradX));
+    __m512 gy = _mm512_permutexvar_ps(h, _mm512_load_ps(gradY));
+    __m512 gz = _mm512_permutexvar_ps(h, _mm512_load_ps(gradZ));
+    __m512 g = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(gx, dx), _mm512_mul_ps(gy, dy)), _mm512_mul_ps(gz, dz));
+
+    t = _mm512_mul_ps(t, t);
+    return _mm512_mul_ps(_mm512_mul_ps(t, t), g);
+}
+
+__attribute__((target("avx512f")))
+static __m512 SampleAVX512(const unsigned *p, __m512 x, __m512 y, __m512 z)
+{
+    __m512 s = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(x, y), z), _mm512_set1_ps(skew));
+    __m512i i = _mm512_cvttps_epi32(_mm512_roundscale_ps(_mm512_add_ps(x, s), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)),
+            j = _mm512_cvttps_epi32(_mm512_roundscale_ps(_mm512_add_ps(y, s), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)),
+            k = _mm512_cvttps_epi32(_mm512_roundscale_ps(_mm512_add_ps(z, s), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+    __m512 t = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_add_epi32(i, j), k)), _mm512_set1_ps(unskew));
+    __m512 x0 = _mm512_sub_ps(x, _mm512_sub_ps(_mm512_cvtepi32_ps(i), t)),
+           y0 = _mm512_sub_ps(y, _mm512_sub_ps(_mm512_cvtepi32_ps(j), t)),
+           z0 = _mm512_sub_ps(z, _mm512_sub_ps(_mm512_cvtepi32_ps(k), t));
+
+    __mmask16 xy = _mm512_cmp_ps_mask(x0, y0, _CMP_GE_OQ), xz = _mm512_cmp_ps_mask(x0, z0, _CMP_GE_OQ);
+    __mmask16 yx = _mm512_cmp_ps_mask(y0, x0, _CMP_GT_OQ), yz = _mm512_cmp_ps_mask(y0, z0, _CMP_GE_OQ);
+    __mmask16 zx = _mm512_cmp_ps_mask(z0, x0, _CMP_GT_OQ), zy = _mm512_cmp_ps_mask(z0, y0, _CMP_GT_OQ);
+    __m512 one = _mm512_set1_ps(1.0f);
+    __m512 i1 = _mm512_maskz_mov_ps(xy & xz, one), i2 = _mm512_maskz_mov_ps(xy | xz, one);
+    __m512 j1 = _mm512_maskz_mov_ps(yx & yz, one), j2 = _mm512_maskz_mov_ps(yx | yz, one);
+    __m512 k1 = _mm512_maskz_mov_ps(zx & zy, one), k2 = _mm512_maskz_mov_ps(zx | zy, one);
+
+    __m512 u1 = _mm512_set1_ps(unskew), u2 = _mm512_set1_ps(2 * unskew), u3 = _mm512_set1_ps(3 * unskew);
+    __m512i ione = _mm512_set1_epi32(1);
+    __m512i pi = LookupAVX512(p, i), pi1 = LookupAVX512(p, _mm512_add_epi32(i, ione));
+    __m512 sum = CornerAVX512(p, pi, j, k, x0, y0, z0);
+    sum = _mm512_add_ps(sum, CornerAVX512(p, _mm512_mask_blend_epi32(xy & xz, pi, pi1), _mm512_add_epi32(j, _mm512_cvttps_epi32(j1)), _mm512_add_epi32(k, _mm512_cvttps_epi32(k1)),
+                                          _mm512_add_ps(_mm512_sub_ps(x0, i1), u1), _mm512_add_ps(_mm512_sub_ps(y0, j1), u1), _mm512_add_ps(_mm512_sub_ps(z0, k1), u1)));
+    sum = _mm512_add_ps(sum, CornerAVX512(p, _mm512_mask_blend_epi32(xy | xz, pi, pi1), _mm512_add_epi32(j, _mm512_cvttps_epi32(j2)), _mm512_add_epi32(k, _mm512_cvttps_epi32(k2)),
+                                          _mm512_add_ps(_mm512_sub_ps(x0, i2), u2), _mm512_add_ps(_mm512_sub_ps(y0, j2), u2), _mm512_add_ps(_mm512_sub_ps(z0, k2), u2)));
+    sum = _mm512_add_ps(sum, CornerAVX512(p, pi1, _mm512_add_epi32(j, ione), _mm512_add_epi32(k, ione),
+                                          _mm512_add_ps(_mm512_sub_ps(x0, one), u3), _mm512_add_ps(_mm512_sub_ps(y0, one), u3), _mm512_add_ps(_mm512_sub_ps(z0, one), u3)));
+    return _mm512_mul_ps(sum, _mm512_set1_ps(scale));
+}
+
+__attribute__((target("avx512f")))
+static __m512 FractalAVX512(const unsigned *permutation, const FractalParams &params, __m512 x, __m512 y, __m512 z)
+{
+    __m512 sum = _mm512_setzero_ps();
+    float amplitude = 1;
+    float max = 0;
+    float frequency = params.frequency;
+    for (unsigned i = 0; i < params.octaves; i++) {
+        float weight = OctaveWeight(frequency, params.spacing);
+        if (weight > 0) {
+            __m512 f = _mm512_set1_ps(frequency);
+            __m512 sample = SampleAVX512(permutation, _mm512_mul_ps(x, f), _mm512_mul_ps(y, f), _mm512_mul_ps(z, f));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(sample, _mm512_set1_ps(amplitude * weight)));
+        }
+
+        max += amplitude;
+
+        frequency *= params.lacunarity;
+        amplitude *= params.persistence;
+    }
+    return _mm512_div_ps(sum, _mm512_set1_ps(max));
+}
+
+__attribute__((target("avx512f")))
+void noise::kernels::SimplexAVX512(const unsigned *permutation, const FractalParams &params, const float *x, const float *y, const float *z, float *out, unsigned count)
+{
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 zi = z ? _mm512_loadu_ps(z + i) : _mm512_setzero_ps();
+        _mm512_storeu_ps(out + i, FractalAVX512(permutation, params, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), zi));
+    }
+    if (i < count) {
+        alignas(64) float tail[4][16] = {};
+        std::copy(x + i, x + count, tail[0]);
+        std::copy(y + i, y + count, tail[1]);
+        if (z) {
+            std::copy(z + i, z + count, tail[2]);
+        }
+        _mm512_store_ps(tail[3], FractalAVX512(permutation, params, _mm512_load_ps(tail[0]), _mm512_load_ps(tail[1]), _mm512_load_ps(tail[2])));
+        std::copy(tail[3], tail[3] + count - i, out + i);
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "SpectralNoise.h"
+#include "NoiseKernels.h"
+#include <random>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+
+using namespace noise;
+
+typedef std::complex<float> Complex;
+
+const unsigned SpectralNoise::MaxResolution;
+
+// Multiplied out by hand, std::complex guards against infinities with a library call per product
+static inline Complex Multiply(Complex a, Complex b)
+{
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+// In-place inverse FFT of n values, n a power of two. The twiddles hold exp(2 pi i k / n) for k < n / 2.
+static void InverseFFT(Complex *data, unsigned n, const Complex *twiddles)
+{
+    for (unsigned i = 1, j = 0; i < n; i++) {
+        unsigned bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (unsigned length = 2; length <= n; length <<= 1) {
+        unsigned half = length / 2, stride = n / length;
+        for (unsigned i = 0; i < n; i += length) {
+            for (unsigned j = 0; j < half; j++) {
+                Complex u = data[i + j];
+                Complex v = Multiply(data[i + j + half], twiddles[j * stride]);
+                data[i + j] = u + v;
+                data[i + j + half] = u - v;
+            }
+        }
+    }
+}
+
+static void Transpose(Complex *data, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        for (unsigned j = i + 1; j < n; j++) {
+            std::swap(data[i * n + j], data[j * n + i]);
+        }
+    }
+}
+
+// Uniform in (0, 1]
+static inline float Uniform(unsigned h)
+{
+    return ((h >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+SpectralNoise::SpectralNoise(uint64_t seed) : octaves(3), frequency(1), persistence(0.5f)
+{
+    Seed(seed);
+}
+
+void SpectralNoise::Seed(uint64_t seed)
+{
+    std::mt19937_64 prng(seed);
+    this->seed = prng();
+    Reshape();
+}
+
+void SpectralNoise::Spectrum(unsigned octaves, float frequency, float persistence)
+{
+    this->octaves = octaves;
+    this->frequency = frequency;
+    this->persistence = persistence;
+    Reshape();
+}
+
+unsigned SpectralNoise::Resolution() const
+{
+    return resolution;
+}
+
+unsigned SpectralNoise::MaxOctaves(float frequency)
+{
+    float base = std::max(frequency, 1.0f);
+    unsigned octaves = 1;
+    while (octaves < 24 && base * std::ldexp(1.0f, octaves + 1) <= MaxResolution / 4) {
+        octaves++;
+    }
+    return octaves;
+}
+
+void SpectralNoise::Reshape()
+{
+    // No band can go below one cycle across the field
+    float base = std::max(frequency, 1.0f);
+
+    // Four samples per cycle of the finest band keep the interpolation between them smooth
+    float top = base * std::ldexp(1.0f, std::min(octaves, 24u));
+    resolution = 16;
+    while (resolution < MaxResolution && resolution < 4 * top) {
+        resolution *= 2;
+    }
+    field = std::make_shared<Field>();
+}
+
+const float *SpectralNoise::Synthesized() const
+{
+    Field &synthesized = *field;
+    std::call_once(synthesized.synthesized, [this, &synthesized] {
+        float base = std::max(frequency, 1.0f);
+        float top = base * std::ldexp(1.0f, std::min(octaves, 24u));
+        unsigned n = resolution;
+        float cutoff = std::min(top, n / 4.0f);
+
+        std::vector<Complex> twiddles(n / 2);
+        for (unsigned k = 0; k < n / 2; k++) {
+            double angle = 2 * M_PI * k / n;
+            twiddles[k] = Complex(cos(angle), sin(angle));
+        }
+
+        // Every bin gets a gaussian of its own, hashed from its wavenumbers so a band looks the same at
+        // any resolution. Spreading the power of an octave over the area of its ring takes the 1 / k.
+        // Bins past the cutoff stay zero, and so do the rows lying entirely past it.
+        int band = (int)ceilf(cutoff);
+        std::vector<Complex> spectrum(n * n);
+        for (int ky = 1 - band; ky < band; ky++) {
+            unsigned i = ky < 0 ? ky + n : ky;
+            for (int kx = 1 - band; kx < band; kx++) {
+                unsigned j = kx < 0 ? kx + n : kx;
+                float k = sqrtf((float)(kx * kx + ky * ky));
+                if (k < base || k >= cutoff) {
+                    continue;
+                }
+
+                float amplitude = powf(persistence, log2f(k / base)) * base / k;
+                float radius = sqrtf(-2.0f * logf(Uniform(kernels::LatticeHash(kx, ky, 0, seed))));
+                float angle = 2 * (float)M_PI * Uniform(kernels::LatticeHash(kx, ky, 1, seed));
+                spectrum[i * n + j] = Complex(amplitude * radius * cosf(angle), amplitude * radius * sinf(angle));
+            }
+        }
+
+        // Rows, then columns through a transpose. The real part of the complex result is a field with
+        // the same spectrum.
+        for (unsigned pass = 0; pass < 2; pass++) {
+            for (unsigned i = 0; i < n; i++) {
+                if (pass == 0 && i >= (unsigned)band && i <= n - band) {
+                    continue;
+                }
+                InverseFFT(&spectrum[i * n], n, twiddles.data());
+            }
+            Transpose(spectrum.data(), n);
+        }
+
+        std::vector<float> &values = synthesized.values;
+        values.resize(n * n);
+        float max = 0;
+        for (unsigned i = 0; i < n * n; i++) {
+            values[i] = spectrum[i].real();
+            max = std::max(max, fabsf(spectrum[i].real()));
+        }
+        if (max > 0) {
+            for (float &v : values) {
+                v /= max;
+            }
+        }
+    });
+    return synthesized.values.data();
+}
+
+float SpectralNoise::Sample(float x, float y) const
+{
+    return Sample(Synthesized(), x, y);
+}
+
+float SpectralNoise::Sample(const float *values, float x, float y) const
+{
+    unsigned mask = resolution - 1;
+
+    float u = x * resolution, v = y * resolution;
+    float fu = floorf(u), fv = floorf(v);
+    float s = u - fu, t = v - fv;
+    unsigned i = (unsigned)(int)fu, j = (unsigned)(int)fv;
+
+    // Catmull-Rom weights, the field wraps around at its edges
+    float wx[4] = {
+        s * (-0.5f + s * (1.0f - 0.5f * s)),
+        1.0f + s * s * (-2.5f + 1.5f * s),
+        s * (0.5f + s * (2.0f - 1.5f * s)),
+        s * s * (-0.5f + 0.5f * s)
+    };
+    float wy[4] = {
+        t * (-0.5f + t * (1.0f - 0.5f * t)),
+        1.0f + t * t * (-2.5f + 1.5f * t),
+        t * (0.5f + t * (2.0f - 1.5f * t)),
+        t * t * (-0.5f + 0.5f * t)
+    };
+
+    float sum = 0;
+    for (unsigned b = 0; b < 4; b++) {
+        const float *row = values + ((j + b - 1) & mask) * resolution;
+        float r = 0;
+        for (unsigned a = 0; a < 4; a++) {
+            r += row[(i + a - 1) & mask] * wx[a];
+        }
+        sum += r * wy[b];
+    }
+    // The interpolation may overshoot the peaks a little
+    return std::min(std::max(sum, -1.0f), 1.0f);
+}
+
+void SpectralNoise::Sample(const float *x, const float *y, float *out, unsigned count) const
+{
+    const float *values = Synthesized();
+    for (unsigned i = 0; i < count; i++) {
+        out[i] = Sample(values, x[i], y[i]);
+    }
+}
+
+bool SpectralNoise::operator==(const SpectralNoise &other) const
+{
+    return field == other.field || (seed == other.seed && octaves == other.octaves &&
+                                    frequency == other.frequency && persistence == other.persistence);
+}
\ No newline at end of file
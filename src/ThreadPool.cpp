@@ -0,0 +1,140 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+
+ThreadPool::ThreadPool(unsigned threadCount) : task(nullptr), generation(0), busy(0), stopping(false)
+{
+    // One queue per worker plus one for the thread calling Run
+    for (unsigned i = 0; i <= threadCount; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Run(unsigned count, const Task &task)
+{
+    std::lock_guard<std::mutex> runLock(runMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+
+        // Deal out contiguous ranges, neighbouring tasks tend to touch the same data
+        unsigned queueCount = queues.size();
+        for (unsigned i = 0; i < queueCount; i++) {
+            std::lock_guard<std::mutex> queueLock(queues[i]->mutex);
+            queues[i]->begin = (uint64_t)count * i / queueCount;
+            queues[i]->end = (uint64_t)count * (i + 1) / queueCount;
+        }
+
+        generation++;
+        busy++;
+    }
+    wake.notify_all();
+
+    Work(queues.size() - 1);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    busy--;
+    idle.wait(lock, [this] { return busy == 0; });
+    this->task = nullptr;
+}
+
+unsigned ThreadPool::ThreadCount() const
+{
+    return threads.size() + 1;
+}
+
+ThreadPool &ThreadPool::Shared()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    unsigned seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            busy++;
+        }
+
+        Work(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        idle.notify_all();
+    }
+}
+
+void ThreadPool::Work(unsigned index)
+{
+    unsigned taskIndex;
+    while (Pop(index, taskIndex) || Steal(index, taskIndex)) {
+        (*task)(taskIndex);
+    }
+}
+
+bool ThreadPool::Pop(unsigned index, unsigned &taskIndex)
+{
+    Queue &queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.begin == queue.end) {
+        return false;
+    }
+    taskIndex = queue.begin++;
+    return true;
+}
+
+bool ThreadPool::Steal(unsigned index, unsigned &taskIndex)
+{
+    unsigned queueCount = queues.size();
+
+    for (unsigned i = 1; i < queueCount; i++) {
+        Queue &victim = *queues[(index + i) % queueCount];
+        unsigned begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end) {
+                continue;
+            }
+            end = victim.end;
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            victim.end = begin;
+        }
+
+        // Keep the first stolen task and queue up the rest of the stolen range
+        Queue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        taskIndex = begin;
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
\ No newline at end of file
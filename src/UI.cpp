@@ -30,6 +30,7 @@ void ShowContextMenu(Workspace &workspace, ImVec2 scenePos)
             ImGui::Separator();
             if (ImGui::MenuItem("Reset", nullptr, false, true)) {
                 node->Reset();
+                node->Touch();
             }
             if (ImGui::MenuItem("Delete", nullptr, false, true)) {
                 node->DisconnectAll();
@@ -58,6 +59,15 @@ void ShowContextMenu(Workspace &workspace, ImVec2 scenePos)
             if (ImGui::MenuItem("Perlin", nullptr, false, !connectingToInput)) {
                 newNode = workspace.CreateNode<Perlin>(scenePos);
             }
+            if (ImGui::MenuItem("Simplex", nullptr, false, !connectingToInput)) {
+                newNode = workspace.CreateNode<Simplex>(scenePos);
+            }
+            if (ImGui::MenuItem("Spectral", nullptr, false, !connectingToInput)) {
+                newNode = workspace.CreateNode<Spectral>(scenePos);
+            }
+            if (ImGui::MenuItem("Voronoi", nullptr, false, !connectingToInput)) {
+                newNode = workspace.CreateNode<Voronoi>(scenePos);
+            }
             if (ImGui::MenuItem("Constant", nullptr, false, !connectingToInput)) {
                 newNode = workspace.CreateNode<Constant>(scenePos);
             }
@@ -71,6 +81,9 @@ void ShowContextMenu(Workspace &workspace, ImVec2 scenePos)
             if (ImGui::MenuItem("Selector", nullptr, false, true)) {
                 newNode = workspace.CreateNode<Selector>(scenePos);
             }
+            if (ImGui::MenuItem("Slope", nullptr, false, true)) {
+                newNode = workspace.CreateNode<Slope>(scenePos);
+            }
             ImGui::Separator();
             if (ImGui::MenuItem("Combine", nullptr, false, true)) {
                 newNode = workspace.CreateNode<Combine>(scenePos);
@@ -103,7 +116,7 @@ void ShowContextMenu(Workspace &workspace, ImVec2 scenePos)
 }
 
 // Adapted from the node graph example by Ocornut: https://gist.github.com/ocornut/7e9b3ec566a333d725d4
-void ShowNodeGraphEditor(bool *opened, Workspace &workspace, NodeRenderer &renderer, GLuint previewTextureID)
+void ShowNodeGraphEditor(bool *opened, Workspace &workspace, PreviewRenderer &preview, GLuint previewTextureID)
 {
     ImGui::SetNextWindowSize(ImVec2(800,600), ImGuiSetCond_FirstUseEver);
     if (!ImGui::Begin("Node Graph Editor", opened, ImGuiWindowFlags_NoBringToFrontOnFocus))
@@ -317,7 +330,7 @@ void ShowNodeGraphEditor(bool *opened, Workspace &workspace, NodeRenderer &rende
 
     ImGui::Begin("Preview", nullptr, ImGuiWindowFlags_NoResize);
 
-    unsigned size = renderer.ImageSize();
+    unsigned size = preview.ImageSize();
 
     ImGui::Image((ImTextureID)previewTextureID, ImVec2(size, size), ImVec2(0, 0), ImVec2(1, 1));
 
@@ -330,13 +343,28 @@ void ShowNodeGraphEditor(bool *opened, Workspace &workspace, NodeRenderer &rende
             node = workspace.GetSelectedNode();
         }
 
-        const NodeRenderer::ImageData &image = renderer.Render(node);
+        // Only re-render when the previewed node or anything upstream of it changed
+        static uint64_t previewHash = 0;
+        uint64_t hash = node->GraphHash();
+
+        if (hash != previewHash) {
+            previewHash = hash;
+            preview.Request(node);
+        }
+    }
+
+    // Upload whichever level of detail the background render has finished, the texture is
+    // stretched to the preview size so coarse levels show up blurred rather than small
+    static NodeRenderer::ImageData image;
+    unsigned imageSize;
 
+    if (preview.Poll(image, imageSize)) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, previewTextureID);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imageSize, imageSize, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data());
     }
 
     ImGui::End();
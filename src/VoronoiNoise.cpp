@@ -1,9 +1,17 @@
 #include "VoronoiNoise.h"
+#include "NoiseKernels.h"
+#include "Simd.h"
 #include <cassert>
 #include <random>
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
+#include <mutex>
+
+#ifdef NOISE_X86_KERNELS
+#include <emmintrin.h>
+#endif
 
 using namespace noise;
 
@@ -22,17 +30,51 @@ unsigned numPointsLookup(unsigned x)
 
 unsigned VoronoiNoise::Hash(unsigned x, unsigned y, unsigned z) const
 {
+    if (hashed) {
+        return kernels::LatticeHash(x, y, z, latticeSeed) & 255;
+    }
+
     unsigned a = permutation[x & 255] + y;
     unsigned b = permutation[a & 255] + z;
     return permutation[b & 255];
 }
 
-VoronoiNoise::VoronoiNoise(uint64_t seed)
+const VoronoiNoise::CellPoints *VoronoiNoise::PointTable()
 {
-    for (unsigned i = 0; i < 256; i++) {
-        permutation[i] = i;
-    }
+    static std::vector<CellPoints> table;
+    static std::once_flag once;
 
+    std::call_once(once, [] {
+        table.resize(256);
+        for (unsigned hash = 0; hash < 256; hash++) {
+            CellPoints &cell = table[hash];
+
+            std::minstd_rand prng(hash);
+            cell.count = numPointsLookup(prng());
+
+            for (unsigned l = 0; l < cell.count; l++) {
+                cell.x[l] = (float)prng() / std::minstd_rand::max();
+                cell.y[l] = (float)prng() / std::minstd_rand::max();
+                cell.z[l] = (float)prng() / std::minstd_rand::max();
+            }
+            // A repeated point can't change the minimum
+            for (unsigned l = cell.count; l < PaddedCellPoints; l++) {
+                cell.x[l] = cell.x[0];
+                cell.y[l] = cell.y[0];
+                cell.z[l] = cell.z[0];
+            }
+        }
+    });
+    return table.data();
+}
+
+unsigned VoronoiNoise::Cell(float v) const
+{
+    return hashed ? (unsigned)v : (unsigned)v & 255;
+}
+
+VoronoiNoise::VoronoiNoise(uint64_t seed) : hashed(false), points(PointTable())
+{
     Seed(seed);
 }
 
@@ -51,13 +93,93 @@ float VoronoiNoise::Chebyshev(float dx, float dy, float dz)
     return std::max({ fabs(dx), fabs(dy), fabs(dz) });
 }
 
+// Metrics for the search. Each one calls the public distance function it stands for, so results
+// can't drift from what a user-supplied DistanceFunc would compute.
+namespace {
+
+    struct EuclideanMetric
+    {
+        float operator()(float dx, float dy, float dz) const { return VoronoiNoise::Euclidean(dx, dy, dz); }
+
+#ifdef NOISE_X86_KERNELS
+        __attribute__((target("sse2")))
+        static __m128 Distance(__m128 dx, __m128 dy, __m128 dz)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        }
+#endif
+    };
+
+    struct ManhattanMetric
+    {
+        float operator()(float dx, float dy, float dz) const { return VoronoiNoise::Manhattan(dx, dy, dz); }
+
+#ifdef NOISE_X86_KERNELS
+        // The scalar version sums in double precision, so this one does too
+        __attribute__((target("sse2")))
+        static __m128 Distance(__m128 dx, __m128 dy, __m128 dz)
+        {
+            __m128 sign = _mm_set1_ps(-0.0f);
+            dx = _mm_andnot_ps(sign, dx);
+            dy = _mm_andnot_ps(sign, dy);
+            dz = _mm_andnot_ps(sign, dz);
+
+            __m128d lo = _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(dx), _mm_cvtps_pd(dy)), _mm_cvtps_pd(dz));
+            __m128d hi = _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(dx, dx)), _mm_cvtps_pd(_mm_movehl_ps(dy, dy))),
+                                    _mm_cvtps_pd(_mm_movehl_ps(dz, dz)));
+            return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+        }
+#endif
+    };
+
+    struct ChebyshevMetric
+    {
+        float operator()(float dx, float dy, float dz) const { return VoronoiNoise::Chebyshev(dx, dy, dz); }
+
+#ifdef NOISE_X86_KERNELS
+        __attribute__((target("sse2")))
+        static __m128 Distance(__m128 dx, __m128 dy, __m128 dz)
+        {
+            __m128 sign = _mm_set1_ps(-0.0f);
+            return _mm_max_ps(_mm_max_ps(_mm_andnot_ps(sign, dx), _mm_andnot_ps(sign, dy)), _mm_andnot_ps(sign, dz));
+        }
+#endif
+    };
+
+    // Any other DistanceFunc, called through the pointer
+    struct CustomMetric
+    {
+        float operator()(float dx, float dy, float dz) const { return distance(dx, dy, dz); }
+
+        VoronoiNoise::DistanceFunc distance;
+    };
+
+}
+
 float VoronoiNoise::Sample(float x, float y, float z) const
 {
     assert(x >= 0 && y >= 0);
 
-    unsigned xCube = (unsigned)x & 255,
-             yCube = (unsigned)y & 255,
-             zCube = (unsigned)z & 255;
+#ifdef NOISE_X86_KERNELS
+    if (ActiveSimdLevel() != SimdLevel::Scalar) {
+        if (distance == &Euclidean) return SampleSSE2<EuclideanMetric>(x, y, z);
+        if (distance == &Manhattan) return SampleSSE2<ManhattanMetric>(x, y, z);
+        if (distance == &Chebyshev) return SampleSSE2<ChebyshevMetric>(x, y, z);
+    }
+#endif
+
+    if (distance == &Euclidean) return SampleScalar(x, y, z, EuclideanMetric());
+    if (distance == &Manhattan) return SampleScalar(x, y, z, ManhattanMetric());
+    if (distance == &Chebyshev) return SampleScalar(x, y, z, ChebyshevMetric());
+    return SampleScalar(x, y, z, CustomMetric{ distance });
+}
+
+template <typename Metric>
+float VoronoiNoise::SampleScalar(float x, float y, float z, Metric metric) const
+{
+    unsigned xCube = Cell(x),
+             yCube = Cell(y),
+             zCube = Cell(z);
 
     float minDist = std::numeric_limits<float>::max();
 
@@ -68,15 +190,10 @@ float VoronoiNoise::Sample(float x, float y, float z) const
                 unsigned yCurCube = yCube + j;
                 unsigned zCurCube = zCube + k;
 
-                std::minstd_rand prng(Hash(xCurCube, yCurCube, zCurCube));
-                unsigned numPoints = numPointsLookup(prng());
-
-                for (unsigned l = 0; l < numPoints; l++) {
-                    float xRel = (float)prng() / std::minstd_rand::max();
-                    float yRel = (float)prng() / std::minstd_rand::max();
-                    float zRel = (float)prng() / std::minstd_rand::max();
+                const CellPoints &cell = points[Hash(xCurCube, yCurCube, zCurCube)];
 
-                    float d = distance(xCurCube + xRel - x, yCurCube + yRel - y, zCurCube + zRel - z);
+                for (unsigned l = 0; l < cell.count; l++) {
+                    float d = metric(xCurCube + cell.x[l] - x, yCurCube + cell.y[l] - y, zCurCube + cell.z[l] - z);
 
                     minDist = std::min(minDist, d);
                 }
@@ -87,14 +204,357 @@ float VoronoiNoise::Sample(float x, float y, float z) const
     return minDist;
 }
 
+#ifdef NOISE_X86_KERNELS
+
+// Tests four feature points of a cell per instruction
+template <typename Metric>
+__attribute__((target("sse2")))
+float VoronoiNoise::SampleSSE2(float x, float y, float z) const
+{
+    unsigned xCube = Cell(x),
+             yCube = Cell(y),
+             zCube = Cell(z);
+
+    __m128 px = _mm_set1_ps(x),
+           py = _mm_set1_ps(y),
+           pz = _mm_set1_ps(z);
+    __m128 minDist = _mm_set1_ps(std::numeric_limits<float>::max());
+
+    for (int i = -1; i < 2; i++) {
+        for (int j = -1; j < 2; j++) {
+            for (int k = -1; k < 2; k++) {
+                unsigned xCurCube = xCube + i;
+                unsigned yCurCube = yCube + j;
+                unsigned zCurCube = zCube + k;
+
+                const CellPoints &cell = points[Hash(xCurCube, yCurCube, zCurCube)];
+
+                __m128 cx = _mm_set1_ps((float)xCurCube),
+                       cy = _mm_set1_ps((float)yCurCube),
+                       cz = _mm_set1_ps((float)zCurCube);
+
+                for (unsigned l = 0; l < cell.count; l += 4) {
+                    __m128 dx = _mm_sub_ps(_mm_add_ps(cx, _mm_loadu_ps(cell.x + l)), px);
+                    __m128 dy = _mm_sub_ps(_mm_add_ps(cy, _mm_loadu_ps(cell.y + l)), py);
+                    __m128 dz = _mm_sub_ps(_mm_add_ps(cz, _mm_loadu_ps(cell.z + l)), pz);
+
+                    minDist = _mm_min_ps(minDist, Metric::Distance(dx, dy, dz));
+                }
+            }
+        }
+    }
+
+    minDist = _mm_min_ps(minDist, _mm_movehl_ps(minDist, minDist));
+    minDist = _mm_min_ss(minDist, _mm_shuffle_ps(minDist, minDist, 1));
+    return _mm_cvtss_f32(minDist);
+}
+
+#endif
+
 float VoronoiNoise::Sample(float x, float y, float z, float frequency) const
 {
     return Sample(x * frequency, y * frequency, z * frequency);
 }
 
+VoronoiNoise::Features VoronoiNoise::SampleFeatures(float x, float y, float z) const
+{
+    assert(x >= 0 && y >= 0);
+
+#ifdef NOISE_X86_KERNELS
+    if (ActiveSimdLevel() != SimdLevel::Scalar) {
+        if (distance == &Euclidean) return SearchFeaturesSSE2<EuclideanMetric>(x, y, z);
+        if (distance == &Manhattan) return SearchFeaturesSSE2<ManhattanMetric>(x, y, z);
+        if (distance == &Chebyshev) return SearchFeaturesSSE2<ChebyshevMetric>(x, y, z);
+    }
+#endif
+
+    if (distance == &Euclidean) return SearchFeatures(x, y, z, EuclideanMetric());
+    if (distance == &Manhattan) return SearchFeatures(x, y, z, ManhattanMetric());
+    if (distance == &Chebyshev) return SearchFeatures(x, y, z, ChebyshevMetric());
+    return SearchFeatures(x, y, z, CustomMetric{ distance });
+}
+
+VoronoiNoise::Features VoronoiNoise::SampleFeatures(float x, float y, float z, float frequency) const
+{
+    return SampleFeatures(x * frequency, y * frequency, z * frequency);
+}
+
+// Runs search on each point scaled by frequency
+template <typename Search>
+void VoronoiNoise::SearchBlock(const float *x, const float *y, const float *z, Features *out, unsigned count, float frequency, Search search) const
+{
+    for (unsigned i = 0; i < count; i++) {
+        assert(x[i] >= 0 && y[i] >= 0);
+        out[i] = search(x[i] * frequency, y[i] * frequency, z ? z[i] * frequency : 0.0f);
+    }
+}
+
+void VoronoiNoise::SampleFeatures(const float *x, const float *y, const float *z, Features *out, unsigned count, float frequency) const
+{
+#ifdef NOISE_X86_KERNELS
+    if (ActiveSimdLevel() != SimdLevel::Scalar) {
+        if (distance == &Euclidean) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeaturesSSE2<EuclideanMetric>(x, y, z); });
+        if (distance == &Manhattan) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeaturesSSE2<ManhattanMetric>(x, y, z); });
+        if (distance == &Chebyshev) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeaturesSSE2<ChebyshevMetric>(x, y, z); });
+    }
+#endif
+
+    if (distance == &Euclidean) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeatures(x, y, z, EuclideanMetric()); });
+    if (distance == &Manhattan) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeatures(x, y, z, ManhattanMetric()); });
+    if (distance == &Chebyshev) return SearchBlock(x, y, z, out, count, frequency, [this](float x, float y, float z) { return SearchFeatures(x, y, z, ChebyshevMetric()); });
+    CustomMetric metric{ distance };
+    SearchBlock(x, y, z, out, count, frequency, [this, metric](float x, float y, float z) { return SearchFeatures(x, y, z, metric); });
+}
+
+void VoronoiNoise::SampleJittered2D(const float *x, const float *y, Features *out, unsigned count, float frequency) const
+{
+    if (distance == &Euclidean) return SearchBlock(x, y, nullptr, out, count, frequency, [this](float x, float y, float) { return SearchJittered2D(x, y, EuclideanMetric()); });
+    if (distance == &Manhattan) return SearchBlock(x, y, nullptr, out, count, frequency, [this](float x, float y, float) { return SearchJittered2D(x, y, ManhattanMetric()); });
+    if (distance == &Chebyshev) return SearchBlock(x, y, nullptr, out, count, frequency, [this](float x, float y, float) { return SearchJittered2D(x, y, ChebyshevMetric()); });
+    CustomMetric metric{ distance };
+    SearchBlock(x, y, nullptr, out, count, frequency, [this, metric](float x, float y, float) { return SearchJittered2D(x, y, metric); });
+}
+
+VoronoiNoise::Features VoronoiNoise::SampleJittered2D(float x, float y) const
+{
+    assert(x >= 0 && y >= 0);
+
+    if (distance == &Euclidean) return SearchJittered2D(x, y, EuclideanMetric());
+    if (distance == &Manhattan) return SearchJittered2D(x, y, ManhattanMetric());
+    if (distance == &Chebyshev) return SearchJittered2D(x, y, ChebyshevMetric());
+    return SearchJittered2D(x, y, CustomMetric{ distance });
+}
+
+VoronoiNoise::Features VoronoiNoise::SampleJittered2D(float x, float y, float frequency) const
+{
+    return SampleJittered2D(x * frequency, y * frequency);
+}
+
+// Scatters feature point ids over [0, 1) with a multiplicative hash
+static float CellID(unsigned point)
+{
+    return ((point * 2654435761u) >> 8) / 16777216.0f;
+}
+
+// Neighbouring cells, nearest first: the sample's own cell, then faces, edges and corners
+static const int cellOrder[27][3] = {
+    {  0,  0,  0 }, { -1,  0,  0 }, {  0, -1,  0 }, {  0,  0, -1 }, {  0,  0,  1 }, {  0,  1,  0 }, {  1,  0,  0 }, { -1, -1,  0 }, { -1,  0, -1 },
+    { -1,  0,  1 }, { -1,  1,  0 }, {  0, -1, -1 }, {  0, -1,  1 }, {  0,  1, -1 }, {  0,  1,  1 }, {  1, -1,  0 }, {  1,  0, -1 }, {  1,  0,  1 },
+    {  1,  1,  0 }, { -1, -1, -1 }, { -1, -1,  1 }, { -1,  1, -1 }, { -1,  1,  1 }, {  1, -1, -1 }, {  1, -1,  1 }, {  1,  1, -1 }, {  1,  1,  1 }
+};
+
+// Offset from the sample to the nearest face of a neighbouring cell. It's computed with the same
+// float operations as the offsets to the cell's points, so by monotonic rounding no point can be
+// closer than this, and the metric of these offsets bounds every distance in the cell from below.
+static float FaceOffset(unsigned cube, int offset, float v)
+{
+    if (offset < 0) return (cube + offset) + 1.0f - v;
+    if (offset > 0) return (cube + offset) + 0.0f - v;
+    return 0.0f;
+}
+
+template <typename Metric>
+VoronoiNoise::Features VoronoiNoise::SearchFeatures(float x, float y, float z, Metric metric) const
+{
+    unsigned xCube = Cell(x),
+             yCube = Cell(y),
+             zCube = Cell(z);
+
+    Features features;
+    features.f1 = std::numeric_limits<float>::max();
+    features.f2 = std::numeric_limits<float>::max();
+    features.cell = 0.0f;
+
+    unsigned nearest = 0;
+
+    for (const int *offset : cellOrder) {
+        // Skip cells that can't hold a point closer than the second nearest one found so far
+        float bound = metric(FaceOffset(xCube, offset[0], x), FaceOffset(yCube, offset[1], y), FaceOffset(zCube, offset[2], z));
+        if (bound >= features.f2) {
+            continue;
+        }
+
+        unsigned xCurCube = xCube + offset[0];
+        unsigned yCurCube = yCube + offset[1];
+        unsigned zCurCube = zCube + offset[2];
+
+        unsigned hash = Hash(xCurCube, yCurCube, zCurCube);
+        const CellPoints &cell = points[hash];
+
+        for (unsigned l = 0; l < cell.count; l++) {
+            float d = metric(xCurCube + cell.x[l] - x, yCurCube + cell.y[l] - y, zCurCube + cell.z[l] - z);
+
+            if (d < features.f1) {
+                features.f2 = features.f1;
+                features.f1 = d;
+                nearest = hash * MaxCellPoints + l;
+            } else if (d < features.f2) {
+                features.f2 = d;
+            }
+        }
+    }
+
+    features.cell = CellID(nearest);
+    return features;
+}
+
+#ifdef NOISE_X86_KERNELS
+
+// Same search and cell order as SearchFeatures, with the cell bounds and the distances to the points
+// of a cell taken four at a time. Cells holding nothing nearer than the second nearest point so far
+// are passed over on a single compare, the others update the features point by point as the scalar
+// search does, so the nearest point wins ties the same way.
+template <typename Metric>
+__attribute__((target("sse2")))
+VoronoiNoise::Features VoronoiNoise::SearchFeaturesSSE2(float x, float y, float z) const
+{
+    unsigned xCube = Cell(x),
+             yCube = Cell(y),
+             zCube = Cell(z);
+
+    __m128 px = _mm_set1_ps(x),
+           py = _mm_set1_ps(y),
+           pz = _mm_set1_ps(z);
+
+    Features features;
+    features.f1 = std::numeric_limits<float>::max();
+    features.f2 = std::numeric_limits<float>::max();
+    features.cell = 0.0f;
+
+    unsigned nearest = 0;
+    alignas(16) float distances[PaddedCellPoints];
+
+    // The bounds of all the cells up front, from the three face offsets along each axis. The last
+    // vector is padded with the first cell.
+    float faces[3][3];
+    for (int offset = -1; offset < 2; offset++) {
+        faces[0][offset + 1] = FaceOffset(xCube, offset, x);
+        faces[1][offset + 1] = FaceOffset(yCube, offset, y);
+        faces[2][offset + 1] = FaceOffset(zCube, offset, z);
+    }
+    alignas(16) float fx[28], fy[28], fz[28], bounds[28];
+    for (unsigned c = 0; c < 28; c++) {
+        const int *offset = cellOrder[c % 27];
+        fx[c] = faces[0][offset[0] + 1];
+        fy[c] = faces[1][offset[1] + 1];
+        fz[c] = faces[2][offset[2] + 1];
+    }
+    for (unsigned c = 0; c < 28; c += 4) {
+        _mm_store_ps(bounds + c, Metric::Distance(_mm_load_ps(fx + c), _mm_load_ps(fy + c), _mm_load_ps(fz + c)));
+    }
+
+    for (unsigned c = 0; c < 27; c++) {
+        const int *offset = cellOrder[c];
+        if (bounds[c] >= features.f2) {
+            continue;
+        }
+
+        unsigned xCurCube = xCube + offset[0];
+        unsigned yCurCube = yCube + offset[1];
+        unsigned zCurCube = zCube + offset[2];
+
+        unsigned hash = Hash(xCurCube, yCurCube, zCurCube);
+        const CellPoints &cell = points[hash];
+
+        __m128 cx = _mm_set1_ps((float)xCurCube),
+               cy = _mm_set1_ps((float)yCurCube),
+               cz = _mm_set1_ps((float)zCurCube);
+
+        // The padding repeats the first point, which leaves the minimum alone
+        __m128 closest = _mm_set1_ps(std::numeric_limits<float>::max());
+        for (unsigned l = 0; l < cell.count; l += 4) {
+            __m128 dx = _mm_sub_ps(_mm_add_ps(cx, _mm_loadu_ps(cell.x + l)), px);
+            __m128 dy = _mm_sub_ps(_mm_add_ps(cy, _mm_loadu_ps(cell.y + l)), py);
+            __m128 dz = _mm_sub_ps(_mm_add_ps(cz, _mm_loadu_ps(cell.z + l)), pz);
+
+            __m128 d = Metric::Distance(dx, dy, dz);
+            _mm_store_ps(distances + l, d);
+            closest = _mm_min_ps(closest, d);
+        }
+        closest = _mm_min_ps(closest, _mm_movehl_ps(closest, closest));
+        closest = _mm_min_ss(closest, _mm_shuffle_ps(closest, closest, 1));
+        if (_mm_cvtss_f32(closest) >= features.f2) {
+            continue;
+        }
+
+        for (unsigned l = 0; l < cell.count; l++) {
+            float d = distances[l];
+
+            if (d < features.f1) {
+                features.f2 = features.f1;
+                features.f1 = d;
+                nearest = hash * MaxCellPoints + l;
+            } else if (d < features.f2) {
+                features.f2 = d;
+            }
+        }
+    }
+
+    features.cell = CellID(nearest);
+    return features;
+}
+
+#endif
+
+template <typename Metric>
+VoronoiNoise::Features VoronoiNoise::SearchJittered2D(float x, float y, Metric metric) const
+{
+    unsigned xCube = Cell(x),
+             yCube = Cell(y);
+
+    float f1 = std::numeric_limits<float>::max();
+    float f2 = std::numeric_limits<float>::max();
+    unsigned nearest = 0;
+
+    for (int i = -1; i < 2; i++) {
+        for (int j = -1; j < 2; j++) {
+            unsigned xCurCube = xCube + i;
+            unsigned yCurCube = yCube + j;
+
+            // The first point of a cell's set doubles as its jittered point
+            unsigned hash = Hash(xCurCube, yCurCube, 0);
+            const CellPoints &cell = points[hash];
+
+            float d = metric(xCurCube + cell.x[0] - x, yCurCube + cell.y[0] - y, 0.0f);
+
+            // Selects rather than branches, so the compiler can emit conditional moves
+            f2 = std::min(f2, std::max(f1, d));
+            nearest = d < f1 ? hash * MaxCellPoints : nearest;
+            f1 = std::min(f1, d);
+        }
+    }
+
+    Features features;
+    features.f1 = f1;
+    features.f2 = f2;
+    features.cell = CellID(nearest);
+    return features;
+}
+
 void VoronoiNoise::Seed(uint64_t seed)
 {
     std::mt19937_64 prng(seed);
 
+    // From the identity, so a seed always gives the same table whatever came before it
+    for (unsigned i = 0; i < 256; i++) {
+        permutation[i] = i;
+    }
     std::shuffle(permutation, permutation + 256, prng);
+    latticeSeed = prng();
+}
+
+bool VoronoiNoise::HashedLattice() const
+{
+    return hashed;
+}
+
+void VoronoiNoise::HashedLattice(bool hashed)
+{
+    this->hashed = hashed;
+}
+
+bool VoronoiNoise::operator==(const VoronoiNoise &other) const
+{
+    return std::equal(permutation, permutation + 256, other.permutation) && latticeSeed == other.latticeSeed &&
+           hashed == other.hashed && distance == other.distance;
 }
\ No newline at end of file
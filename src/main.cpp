@@ -37,7 +37,7 @@ int main(int, char**)
     bool show_window = true;
 
     Workspace workspace;
-    NodeRenderer renderer;
+    PreviewRenderer preview;
     GLuint previewTexureID;
 
     glGenTextures(1, &previewTexureID);
@@ -55,7 +55,7 @@ int main(int, char**)
         }
         ImGui_ImplSdlGL3_NewFrame(window);
 
-        ShowNodeGraphEditor(&show_window, workspace, renderer, previewTexureID);
+        ShowNodeGraphEditor(&show_window, workspace, preview, previewTexureID);
 
         // Rendering
         glViewport(0, 0, (int)ImGui::GetIO().DisplaySize.x, (int)ImGui::GetIO().DisplaySize.y);